@@ -0,0 +1,294 @@
+#include "seal/seal.h"
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <sstream>
+
+using namespace std;
+using namespace seal;
+
+/*
+Microbenchmarks of the BFV primitives the PIR binaries and bfv_playground are built from, one
+benchmark per primitive, each over n = 1024 .. 32768 (BFVDefault coefficient modulus) and over
+the first levels of the modulus chain (level 0 is the top data level; every level drops one
+prime). items_per_second is the primitive's ops/s, which is what the PIR cost models use.
+
+    ./bfv_microbench --benchmark_filter='multiply_plain' --benchmark_format=json
+*/
+
+// keys and tools for one n; keygen is expensive, so they are built once and shared by every benchmark
+struct BFVSetup {
+    SEALContext context;
+    KeyGenerator keygen;
+    SecretKey secret_key;
+    RelinKeys relin_keys;
+    Encryptor encryptor;
+    Evaluator evaluator;
+    Decryptor decryptor;
+    Plaintext plain;
+
+    explicit BFVSetup(const EncryptionParameters& parms)
+        : context(parms), keygen(context), secret_key(keygen.secret_key()), encryptor(context, secret_key),
+          evaluator(context), decryptor(context, secret_key), plain("3x^2 + 2x^1 + 1") {
+        // the smallest n has a single prime and so no special prime to switch keys with
+        if (context.using_keyswitching()) {
+            keygen.create_relin_keys(relin_keys);
+        }
+    }
+};
+
+BFVSetup& bfv_setup(size_t poly_modulus_degree) {
+    static map<size_t, unique_ptr<BFVSetup>> setups;
+    auto& setup = setups[poly_modulus_degree];
+    if (!setup) {
+        EncryptionParameters parms(scheme_type::bfv);
+        parms.set_poly_modulus_degree(poly_modulus_degree);
+        parms.set_coeff_modulus(CoeffModulus::BFVDefault(poly_modulus_degree));
+        parms.set_plain_modulus(1024);
+        setup = make_unique<BFVSetup>(parms);
+    }
+    return *setup;
+}
+
+// a fresh encryption of the setup's plaintext, switched down to the benchmark's level;
+// false (and the benchmark skipped) when the chain is not that long
+bool encrypt_at_level(benchmark::State& state, BFVSetup& s, Ciphertext& ct) {
+    s.encryptor.encrypt_symmetric(s.plain, ct);
+    for (int64_t level = 0; level < state.range(1); level++) {
+        auto next = s.context.get_context_data(ct.parms_id())->next_context_data();
+        if (!next) {
+            state.SkipWithError("level is not in the modulus chain");
+            return false;
+        }
+        s.evaluator.mod_switch_to_next_inplace(ct);
+    }
+    return true;
+}
+
+void bfv_args(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"n", "level"});
+    for (int64_t n = 1024; n <= 32768; n *= 2) {
+        for (int64_t level = 0; level <= 2; level++) {
+            b->Args({n, level});
+        }
+    }
+}
+
+// for primitives that only run at the top level (encryption, key-level NTTs)
+void bfv_top_args(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"n", "level"});
+    for (int64_t n = 1024; n <= 32768; n *= 2) {
+        b->Args({n, 0});
+    }
+}
+
+void BM_encrypt_symmetric(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext ct;
+    for (auto _ : state) {
+        s.encryptor.encrypt_symmetric(s.plain, ct);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_encrypt_symmetric)->Apply(bfv_top_args);
+
+void BM_multiply_plain(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext ct, out;
+    if (!encrypt_at_level(state, s, ct)) {
+        return;
+    }
+    for (auto _ : state) {
+        s.evaluator.multiply_plain(ct, s.plain, out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_multiply_plain)->Apply(bfv_args);
+
+// against a plaintext already in NTT form, as pre-NTT'd database files are
+void BM_multiply_plain_ntt(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext ct, out;
+    if (!encrypt_at_level(state, s, ct)) {
+        return;
+    }
+    Plaintext plain_ntt;
+    s.evaluator.transform_to_ntt(s.plain, ct.parms_id(), plain_ntt);
+    s.evaluator.transform_to_ntt_inplace(ct);
+    for (auto _ : state) {
+        s.evaluator.multiply_plain(ct, plain_ntt, out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_multiply_plain_ntt)->Apply(bfv_args);
+
+void BM_add_inplace(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext acc, ct;
+    if (!encrypt_at_level(state, s, acc) || !encrypt_at_level(state, s, ct)) {
+        return;
+    }
+    for (auto _ : state) {
+        s.evaluator.add_inplace(acc, ct);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_add_inplace)->Apply(bfv_args);
+
+void BM_multiply(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext a, b, out;
+    if (!encrypt_at_level(state, s, a) || !encrypt_at_level(state, s, b)) {
+        return;
+    }
+    for (auto _ : state) {
+        s.evaluator.multiply(a, b, out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_multiply)->Apply(bfv_args);
+
+void BM_square(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext ct, out;
+    if (!encrypt_at_level(state, s, ct)) {
+        return;
+    }
+    for (auto _ : state) {
+        s.evaluator.square(ct, out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_square)->Apply(bfv_args);
+
+void BM_relinearize(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    if (!s.context.using_keyswitching()) {
+        state.SkipWithError("no key switching with a single prime");
+        return;
+    }
+    Ciphertext ct, squared, out;
+    if (!encrypt_at_level(state, s, ct)) {
+        return;
+    }
+    s.evaluator.square(ct, squared);
+    for (auto _ : state) {
+        s.evaluator.relinearize(squared, s.relin_keys, out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_relinearize)->Apply(bfv_args);
+
+void BM_mod_switch_to_next(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext ct, out;
+    if (!encrypt_at_level(state, s, ct)) {
+        return;
+    }
+    if (!s.context.get_context_data(ct.parms_id())->next_context_data()) {
+        state.SkipWithError("already at the last level");
+        return;
+    }
+    for (auto _ : state) {
+        s.evaluator.mod_switch_to_next(ct, out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_mod_switch_to_next)->Apply(bfv_args);
+
+void BM_transform_to_ntt(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext ct, out;
+    if (!encrypt_at_level(state, s, ct)) {
+        return;
+    }
+    for (auto _ : state) {
+        s.evaluator.transform_to_ntt(ct, out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_transform_to_ntt)->Apply(bfv_args);
+
+void BM_transform_from_ntt(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext ct, out;
+    if (!encrypt_at_level(state, s, ct)) {
+        return;
+    }
+    s.evaluator.transform_to_ntt_inplace(ct);
+    for (auto _ : state) {
+        s.evaluator.transform_from_ntt(ct, out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_transform_from_ntt)->Apply(bfv_args);
+
+// encoding one database plaintext for a pre-NTT'd file
+void BM_transform_plain_to_ntt(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Plaintext out;
+    for (auto _ : state) {
+        s.evaluator.transform_to_ntt(s.plain, s.context.first_parms_id(), out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_transform_plain_to_ntt)->Apply(bfv_top_args);
+
+void BM_serialize(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext ct;
+    if (!encrypt_at_level(state, s, ct)) {
+        return;
+    }
+    auto compr_mode = state.range(2) ? Serialization::compr_mode_default : compr_mode_type::none;
+    for (auto _ : state) {
+        stringstream ss;
+        ct.save(ss, compr_mode);
+        benchmark::DoNotOptimize(ss);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * ct.save_size(compr_mode));
+}
+BENCHMARK(BM_serialize)->Apply([](benchmark::internal::Benchmark* b) {
+    b->ArgNames({"n", "level", "compressed"});
+    for (int64_t n = 1024; n <= 32768; n *= 2) {
+        for (int64_t level = 0; level <= 2; level++) {
+            b->Args({n, level, 0});
+            b->Args({n, level, 1});
+        }
+    }
+});
+
+void BM_deserialize(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext ct, out;
+    if (!encrypt_at_level(state, s, ct)) {
+        return;
+    }
+    stringstream saved;
+    ct.save(saved, compr_mode_type::none);
+    string bytes = saved.str();
+    for (auto _ : state) {
+        stringstream ss(bytes);
+        out.load(s.context, ss);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_deserialize)->Apply(bfv_args);
+
+void BM_decrypt(benchmark::State& state) {
+    BFVSetup& s = bfv_setup(state.range(0));
+    Ciphertext ct;
+    Plaintext out;
+    if (!encrypt_at_level(state, s, ct)) {
+        return;
+    }
+    for (auto _ : state) {
+        s.decryptor.decrypt(ct, out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_decrypt)->Apply(bfv_args);
+
+BENCHMARK_MAIN();
@@ -1,14 +1,24 @@
 #include "seal/seal.h"
+#include "pir_bench.h"
 #include <iostream>
-#include <time.h>
 
 using namespace std;
 using namespace seal;
 
 // declare function
-void bfv_playground(int selection);
+int bfv_playground(int selection, const BenchOptions& bench_opts);
+
+int main(int argc, char* argv[]) {
+    // benchmark options, see print_bench_usage
+    BenchOptions bench_opts;
+    for (int i = 1; i < argc; i++) {
+        if (!parse_bench_option(argc, argv, i, bench_opts)) {
+            cout << "Usage: " << argv[0] << endl;
+            print_bench_usage(argv[0]);
+            return 1;
+        }
+    }
 
-int main() {
     while (1) {
         cout << "+---------------------------------------------------------+" << endl;
         cout << "| Please enter a number corresponding to the polynomial   |" << endl;
@@ -30,7 +40,9 @@ int main() {
         cin >> selection;
 
         if (selection > 0) {
-            bfv_playground(selection);
+            if (bfv_playground(selection, bench_opts) != 0) {
+                return 1;
+            }
         }
         else {
             return 0;
@@ -40,10 +52,11 @@ int main() {
 }
 
 
-void bfv_playground(int selection) {
+int bfv_playground(int selection, const BenchOptions& bench_opts) {
     EncryptionParameters parms(scheme_type::bfv);
-    clock_t start;
-    clock_t t;
+    // each computation below is repeated as --warmup / --trials ask
+    BenchHarness bench("bfv_playground", bench_opts);
+    bench.note("selection", selection);
 
     // n
     // select from 1024, 2048, 4096, 8192, 16384, 32768
@@ -65,6 +78,8 @@ void bfv_playground(int selection) {
     parms.set_plain_modulus(plain_mod);
 
     SEALContext context(parms);
+    bench.note("n", poly_modulus_degree);
+    bench.note("t", plain_mod);
 
     cout << "Parameter validation (success): " << context.parameter_error_message() << endl;
 
@@ -80,7 +95,8 @@ void bfv_playground(int selection) {
     uint64_t x = 9;
     Plaintext x_plain(seal::util::uint_to_hex_string(&x, size_t(1)));
     Ciphertext x_encrypted;
-    encryptor.encrypt_symmetric(x_plain, x_encrypted);
+    bench.run("encrypt", [&]() { encryptor.encrypt_symmetric(x_plain, x_encrypted); });
+    printf("Encryption time (s): %f\n", bench.median("encrypt"));
 
     cout << "    + size of freshly encrypted x: " << x_encrypted.size() << endl;
     cout << "    + noise budget in freshly encrypted x: " << decryptor.invariant_noise_budget(x_encrypted) << " bits"
@@ -88,96 +104,102 @@ void bfv_playground(int selection) {
 
     Ciphertext x_result_encrypted;
     // We always want to minimize the multiplicative depth
-    
+
+    RelinKeys relin_keys;
+    if (selection == 6 || selection == 7) {
+        keygen.create_relin_keys(relin_keys);
+    }
+
     // Make switch statement
     // Measure time of computations
         // relinearization, multiplications
-    start = clock();
-    if (selection == 1) {
-        // do nothing, since we are just decrypting x
-        x_result_encrypted = x_encrypted;
-    }
-    else if (selection == 2) {
-        // x^2
-        evaluator.square(x_encrypted, x_result_encrypted);
-    }
-    else if (selection == 3) {
-        // x^2 + 1
-        evaluator.square(x_encrypted, x_result_encrypted);
-        Plaintext one("1");
-        evaluator.add_plain_inplace(x_result_encrypted, one);
-        //one.data()
-    }
-    else if (selection == 4) {
-        // x^2 + x
-        evaluator.square(x_encrypted, x_result_encrypted);
-        evaluator.add_inplace(x_result_encrypted, x_encrypted);
-    }
-    else if (selection == 5) {
-        // x^2 + 3*x
-        clock_t mult_start;
-        clock_t time;
-
-        Ciphertext three_x_encrypted;
-        mult_start = clock();
-        evaluator.square(x_encrypted, x_result_encrypted);
-        time = clock() - mult_start;
-        printf("Ciphertext - Ciphertext multiplication time (s): %f\n", ((float)time)/CLOCKS_PER_SEC);
-
-        mult_start = clock();
-        evaluator.multiply_plain(x_encrypted, Plaintext("3"), three_x_encrypted);
-        time = clock() - mult_start;
-        printf("Ciphertext - Plaintext multiplication time (s): %f\n", ((float)time)/CLOCKS_PER_SEC);
-
-        evaluator.add_inplace(x_result_encrypted, three_x_encrypted);
-    }
-    // multiplication of a and b results in size a+b-1
-    else if (selection == 6) {
-        RelinKeys relin_keys;
-        keygen.create_relin_keys(relin_keys);
-        // x^4 with no relinearization
-        evaluator.square(x_encrypted, x_result_encrypted);
-        // evaluator.relinearize_inplace(x_result_encrypted, relin_keys);
-        evaluator.square_inplace(x_result_encrypted);
-
-        // evaluator.multiply(x_encrypted, x_encrypted, x_result_encrypted);
-        // evaluator.multiply_inplace(x_result_encrypted, x_encrypted);
-        // evaluator.multiply_inplace(x_result_encrypted, x_encrypted);
-        
-        // Ciphertext three_encrypted;
-        // encryptor.encrypt_symmetric(Plaintext("3"), three_encrypted);
-        // evaluator.multiply_inplace(x_result_encrypted, three_encrypted);
-        // evaluator.relinearize_inplace(x_result_encrypted, relin_keys);
-        // evaluator.multiply_inplace(x_result_encrypted, three_encrypted);
-        // evaluator.relinearize_inplace(x_result_encrypted, relin_keys);
-        // evaluator.square_inplace(x_result_encrypted);
+    bench.run("compute", [&]() {
+        if (selection == 1) {
+            // do nothing, since we are just decrypting x
+            x_result_encrypted = x_encrypted;
+        }
+        else if (selection == 2) {
+            // x^2
+            evaluator.square(x_encrypted, x_result_encrypted);
+        }
+        else if (selection == 3) {
+            // x^2 + 1
+            evaluator.square(x_encrypted, x_result_encrypted);
+            Plaintext one("1");
+            evaluator.add_plain_inplace(x_result_encrypted, one);
+            //one.data()
+        }
+        else if (selection == 4) {
+            // x^2 + x
+            evaluator.square(x_encrypted, x_result_encrypted);
+            evaluator.add_inplace(x_result_encrypted, x_encrypted);
+        }
+        else if (selection == 5) {
+            // x^2 + 3*x
+            Ciphertext three_x_encrypted;
+            evaluator.square(x_encrypted, x_result_encrypted);
+            evaluator.multiply_plain(x_encrypted, Plaintext("3"), three_x_encrypted);
+            evaluator.add_inplace(x_result_encrypted, three_x_encrypted);
+        }
+        // multiplication of a and b results in size a+b-1
+        else if (selection == 6) {
+            // x^4 with no relinearization
+            evaluator.square(x_encrypted, x_result_encrypted);
+            // evaluator.relinearize_inplace(x_result_encrypted, relin_keys);
+            evaluator.square_inplace(x_result_encrypted);
+
+            // evaluator.multiply(x_encrypted, x_encrypted, x_result_encrypted);
+            // evaluator.multiply_inplace(x_result_encrypted, x_encrypted);
+            // evaluator.multiply_inplace(x_result_encrypted, x_encrypted);
+
+            // Ciphertext three_encrypted;
+            // encryptor.encrypt_symmetric(Plaintext("3"), three_encrypted);
+            // evaluator.multiply_inplace(x_result_encrypted, three_encrypted);
+            // evaluator.relinearize_inplace(x_result_encrypted, relin_keys);
+            // evaluator.multiply_inplace(x_result_encrypted, three_encrypted);
+            // evaluator.relinearize_inplace(x_result_encrypted, relin_keys);
+            // evaluator.square_inplace(x_result_encrypted);
+        }
+        else if (selection == 7) {
+            // x^4 with relinearization
+            evaluator.square(x_encrypted, x_result_encrypted);
+            evaluator.relinearize_inplace(x_result_encrypted, relin_keys);
+            evaluator.square_inplace(x_result_encrypted);
+            evaluator.relinearize_inplace(x_result_encrypted, relin_keys);
+        }
+    });
+    printf("Computation time (s): %f\n", bench.median("compute"));
+
+    // the steps of a selection are timed as phases of their own, from the same inputs, so each
+    // gets exactly --trials samples and no warm-up run
+    Ciphertext step_result;
+    if (selection == 5) {
+        bench.run("multiply_cc", [&]() { evaluator.square(x_encrypted, step_result); });
+        bench.run("multiply_cp", [&]() { evaluator.multiply_plain(x_encrypted, Plaintext("3"), step_result); });
+        printf("Ciphertext - Ciphertext multiplication time (s): %f\n", bench.median("multiply_cc"));
+        printf("Ciphertext - Plaintext multiplication time (s): %f\n", bench.median("multiply_cp"));
     }
     else if (selection == 7) {
-        // x^4 with relinearization
-        clock_t relin_start;
-        clock_t time;
-
-        RelinKeys relin_keys;
-        keygen.create_relin_keys(relin_keys);
-
-        evaluator.square(x_encrypted, x_result_encrypted);
-        relin_start = clock();
-        evaluator.relinearize_inplace(x_result_encrypted, relin_keys);
-        time = clock() - relin_start;
-        printf("Relinearization time (s): %f\n", ((float)time)/CLOCKS_PER_SEC);
-        evaluator.square_inplace(x_result_encrypted);
-        evaluator.relinearize_inplace(x_result_encrypted, relin_keys);
+        // both size-3 inputs the computation relinearizes: x^2 and (relinearized x^2)^2
+        Ciphertext x_squared;
+        Ciphertext x_fourth;
+        evaluator.square(x_encrypted, x_squared);
+        evaluator.relinearize(x_squared, relin_keys, x_fourth);
+        evaluator.square_inplace(x_fourth);
+        bench.run("relinearize_x2", [&]() { evaluator.relinearize(x_squared, relin_keys, step_result); });
+        bench.run("relinearize_x4", [&]() { evaluator.relinearize(x_fourth, relin_keys, step_result); });
+        printf("Relinearization time, x^2 (s): %f\n", bench.median("relinearize_x2"));
+        printf("Relinearization time, x^4 (s): %f\n", bench.median("relinearize_x4"));
     }
-    t = clock() - start;
-    printf("Computation time (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
 
     Plaintext x_result_decrypted;
-    cout << "    + decryption of x_result_encrypted: ";
-    decryptor.decrypt(x_result_encrypted, x_result_decrypted);
-    cout << "0x" << x_result_decrypted.to_string() << endl;
+    bench.run("decrypt", [&]() { decryptor.decrypt(x_result_encrypted, x_result_decrypted); });
+    printf("Decryption time (s): %f\n", bench.median("decrypt"));
+    cout << "    + decryption of x_result_encrypted: 0x" << x_result_decrypted.to_string() << endl;
 
     cout << "    + size of encrypted x after computation: " << x_result_encrypted.size() << endl;
     cout << "    + noise budget in encrypted x after computation: " << decryptor.invariant_noise_budget(x_result_encrypted) << " bits"
          << endl;
 
+    return bench.report();
 }
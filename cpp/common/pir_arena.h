@@ -0,0 +1,87 @@
+#pragma once
+
+#include "seal/seal.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+/*
+Reusable ciphertext storage for allocation-free scans. A SEAL Ciphertext always owns its
+data through a MemoryPoolHandle and cannot be pointed at caller memory, so an arena here is
+a batch of ciphertexts drawn from one dedicated pool and reserved up front at their final
+size (3 polynomials covers ct x ct products). The scan kernels' *_into variants write into
+these and into reusable scratch ciphertexts, and SEAL's internal temporaries come back from
+the same pool's free lists, so once a query has run the next one allocates nothing.
+*/
+class CiphertextArena {
+public:
+    CiphertextArena(const seal::SEALContext& context, seal::parms_id_type parms_id, size_t count, size_t size_capacity = 3,
+                    seal::MemoryPoolHandle pool = seal::MemoryPoolHandle::New())
+        : pool_(pool) {
+        ciphertexts_.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            ciphertexts_.emplace_back(context, parms_id, size_capacity, pool_);
+        }
+    }
+
+    seal::Ciphertext& operator[](size_t i) { return ciphertexts_[i]; }
+    std::vector<seal::Ciphertext>& ciphertexts() { return ciphertexts_; }
+    size_t size() const { return ciphertexts_.size(); }
+    seal::MemoryPoolHandle pool() const { return pool_; }
+
+private:
+    seal::MemoryPoolHandle pool_;
+    std::vector<seal::Ciphertext> ciphertexts_;
+};
+
+// global operator new calls so far; only counts in a binary compiled with PIR_COUNT_ALLOCATIONS
+// (vector_pr_check_alloc), which replaces the allocation functions. Timed builds leave it
+// undefined and keep the stock allocator.
+inline std::atomic<size_t>& heap_allocation_count() {
+    static std::atomic<size_t> count{0};
+    return count;
+}
+
+#ifdef PIR_COUNT_ALLOCATIONS
+void* operator new(std::size_t size) {
+    heap_allocation_count().fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, std::align_val_t align) {
+    heap_allocation_count().fetch_add(1, std::memory_order_relaxed);
+    size_t alignment = static_cast<size_t>(align);
+    if (void* p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t align) { return operator new(size, align); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#endif
+
+// SEAL grows its pools with aligned allocations that bypass operator new, so both counts are needed
+struct AllocationSnapshot {
+    size_t heap_allocations = 0;
+    size_t pool_bytes = 0;
+};
+
+inline AllocationSnapshot allocation_snapshot(const std::vector<seal::MemoryPoolHandle>& pools) {
+    AllocationSnapshot snapshot;
+    snapshot.heap_allocations = heap_allocation_count().load();
+    for (const auto& pool : pools) {
+        snapshot.pool_bytes += pool.alloc_byte_count();
+    }
+    return snapshot;
+}
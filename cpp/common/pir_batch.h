@@ -0,0 +1,164 @@
+#pragma once
+
+#include "pir_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/*
+Batch PIR with probabilistic batch codes: to fetch k records at once the database is split
+into about 1.5k buckets. Every record is replicated into each of its hash_count candidate
+buckets (about hash_count * N slots in total), the client cuckoo-hashes its k indices so
+each bucket holds at most one of them, and then sends one small VectorPR query per bucket.
+The server scans hash_count * N slots for the whole batch instead of k * N for k separate
+retrievals.
+*/
+
+// splitmix64 finalizer
+inline uint64_t pir_hash64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+struct BatchPIRParams {
+    size_t num_buckets = 1;
+    size_t hash_count = 3;
+    uint64_t seed = 0;
+};
+
+// 1.5k buckets with 3 hash functions keeps cuckoo insertion failures negligible
+inline BatchPIRParams batch_pir_params(size_t batch_size, uint64_t seed = 0) {
+    BatchPIRParams params;
+    params.num_buckets = std::max<size_t>((batch_size * 3 + 1) / 2, 1);
+    params.seed = seed;
+    return params;
+}
+
+inline size_t batch_bucket(uint64_t index, size_t hash, const BatchPIRParams& params) {
+    return pir_hash64(index ^ pir_hash64(params.seed + hash)) % params.num_buckets;
+}
+
+// bucket contents; derived only from public values, so client and server build the same layout
+struct BatchPIRLayout {
+    BatchPIRParams params;
+    std::vector<std::vector<uint64_t>> buckets;    // database indices held by each bucket, ascending
+    std::vector<size_t> sides;                     // bucket b is padded to a sides[b] x sides[b] square
+
+    BatchPIRLayout(size_t db_len, const BatchPIRParams& params) : params(params), buckets(params.num_buckets), sides(params.num_buckets) {
+        for (uint64_t i = 0; i < db_len; i++) {
+            for (size_t h = 0; h < params.hash_count; h++) {
+                std::vector<uint64_t>& bucket = buckets[batch_bucket(i, h, params)];
+                // two hash functions may pick the same bucket; store the record once
+                if (bucket.empty() || bucket.back() != i) {
+                    bucket.push_back(i);
+                }
+            }
+        }
+        for (size_t b = 0; b < buckets.size(); b++) {
+            sides[b] = std::max<size_t>((size_t)std::ceil(std::sqrt((double)buckets[b].size())), 1);
+        }
+    }
+
+    size_t position(size_t bucket, uint64_t index) const {
+        return std::lower_bound(buckets[bucket].begin(), buckets[bucket].end(), index) - buckets[bucket].begin();
+    }
+
+    size_t total_slots() const {
+        size_t total = 0;
+        for (size_t side : sides) {
+            total += side * side;
+        }
+        return total;
+    }
+};
+
+// places each index in one of its candidate buckets with no two sharing a bucket;
+// assignment[b] is the index placed in bucket b or -1. Returns -1 if insertion fails.
+inline int cuckoo_assign(const std::vector<uint64_t>& indices, const BatchPIRParams& params, std::vector<int64_t>& assignment) {
+    assignment.assign(params.num_buckets, -1);
+    std::mt19937_64 rng(params.seed);
+    size_t max_evictions = 100 * std::max<size_t>(indices.size(), 1);
+
+    for (uint64_t index : indices) {
+        int64_t current = index;
+        size_t evictions = 0;
+        while (current >= 0) {
+            // take any free candidate bucket, otherwise evict a random occupant and re-place it
+            int64_t evicted = -1;
+            for (size_t h = 0; h < params.hash_count && current >= 0; h++) {
+                size_t b = batch_bucket(current, h, params);
+                if (assignment[b] == current) {
+                    // duplicate request for the same index
+                    current = -1;
+                } else if (assignment[b] < 0) {
+                    assignment[b] = current;
+                    current = -1;
+                }
+            }
+            if (current < 0) {
+                break;
+            }
+            if (++evictions > max_evictions) {
+                std::cout << "ERROR: Cuckoo insertion failed, retry with another seed or more buckets" << std::endl;
+                return -1;
+            }
+            size_t b = batch_bucket(current, rng() % params.hash_count, params);
+            evicted = assignment[b];
+            assignment[b] = current;
+            current = evicted;
+        }
+    }
+    return 0;
+}
+
+// one VectorPR query per bucket
+struct BucketQuery {
+    std::vector<seal::Ciphertext> col_select_vec;
+    std::vector<seal::Ciphertext> row_select_vec;
+};
+
+inline int batch_pir_query(const BatchPIRLayout& layout, const std::vector<int64_t>& assignment, seal::Encryptor* encryptor,
+                           std::vector<BucketQuery>& queries) {
+    queries.resize(layout.buckets.size());
+    for (size_t b = 0; b < layout.buckets.size(); b++) {
+        size_t side = layout.sides[b];
+        // empty buckets still get a (dummy) query so the server cannot tell which buckets matter
+        size_t pos = assignment[b] >= 0 ? layout.position(b, assignment[b]) : 0;
+        queries[b].col_select_vec.resize(side);
+        queries[b].row_select_vec.resize(side);
+        populate_retrieval_vectors(queries[b].col_select_vec, queries[b].row_select_vec, side, pos, encryptor);
+    }
+    return 0;
+}
+
+class BatchPIRServer {
+public:
+    // padding slots hold 1 rather than 0 so no product comes out as a transparent ciphertext
+    BatchPIRServer(const std::vector<seal::Plaintext>& data, const BatchPIRLayout& layout) : layout_(layout) {
+        buckets_.resize(layout.buckets.size());
+        for (size_t b = 0; b < layout.buckets.size(); b++) {
+            size_t side = layout.sides[b];
+            buckets_[b].assign(side, std::vector<seal::Plaintext>(side, seal::Plaintext("1")));
+            for (size_t pos = 0; pos < layout.buckets[b].size(); pos++) {
+                buckets_[b][pos / side][pos % side] = data[layout.buckets[b][pos]];
+            }
+        }
+    }
+
+    // one response ciphertext per bucket, each the VectorPR answer for that bucket's query
+    std::vector<seal::Ciphertext> answer(std::vector<BucketQuery>& queries, seal::Evaluator* evaluator, seal::Decryptor* d) {
+        std::vector<seal::Ciphertext> responses(buckets_.size());
+        for (size_t b = 0; b < buckets_.size(); b++) {
+            responses[b] = vector_pr_answer(queries[b].col_select_vec, queries[b].row_select_vec, buckets_[b], layout_.sides[b], evaluator, d);
+        }
+        return responses;
+    }
+
+private:
+    const BatchPIRLayout& layout_;
+    std::vector<std::vector<std::vector<seal::Plaintext>>> buckets_;
+};
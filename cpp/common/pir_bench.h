@@ -0,0 +1,484 @@
+#pragma once
+
+#include "seal/seal.h"
+#include "pir_perf.h"
+#include "pir_trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <time.h>
+
+/*
+Benchmark harness shared by the PIR binaries. clock() is process CPU time summed over all
+threads, so it overstates anything parallel and says nothing about time spent blocked; every
+phase here is timed on the monotonic wall clock, with process CPU time recorded next to it.
+A phase can be run W times untimed to warm caches and pools, then N times timed, and is
+reported as min / median / p95 / p99 over the trials, on stdout and optionally as JSON or CSV.
+With --perf, repeated phases also read the hardware counters in pir_perf.h around every trial;
+without it nothing is opened and a trial costs one null check outside the timed region.
+With --trace, every timed trial is also a span on the pir_trace.h timeline, around the spans
+the kernels record inside it.
+*/
+
+// splitmix64. The Rust binaries (rust/*/src/bench.rs) implement the same generator, so one seed
+// names the same database in both libraries
+inline uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// count database values between 1 and plain_modulus - 1, in row-major order
+inline std::vector<uint64_t> shared_db_values(uint64_t seed, size_t count, uint64_t plain_modulus) {
+    std::vector<uint64_t> values(count);
+    uint64_t state = seed;
+    for (auto& v : values) {
+        v = splitmix64(state) % (plain_modulus - 1) + 1;
+    }
+    return values;
+}
+
+// rows x cols of the shared database: one row for TrivialPR, vec_len x vec_len for VectorPR.
+// Returns false if a square layout was asked for and len is not a square
+inline bool shared_db_shape(size_t len, bool square, size_t& rows, size_t& cols) {
+    size_t vec_len = (size_t)std::sqrt((double)len);
+    if (square && vec_len * vec_len != len) {
+        return false;
+    }
+    rows = square ? vec_len : 1;
+    cols = square ? vec_len : len;
+    return true;
+}
+
+// the shared values as one constant plaintext each, filled row-major into rows x cols
+inline std::vector<std::vector<seal::Plaintext>> shared_db_plaintexts(const std::vector<uint64_t>& values, size_t rows,
+                                                                      size_t cols) {
+    std::vector<std::vector<seal::Plaintext>> data(rows, std::vector<seal::Plaintext>(cols));
+    for (size_t i = 0; i < rows * cols; i++) {
+        data[i / cols][i % cols] = seal::Plaintext(seal::util::uint_to_hex_string(&values[i], size_t(1)));
+    }
+    return data;
+}
+
+// the non-empty pieces of s between separators, for list-valued command line options
+inline std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> parts;
+    std::stringstream ss(s);
+    std::string part;
+    while (std::getline(ss, part, sep)) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+// command line options for the harness; parsed as part of DBOptions, or on their own by bfv_playground
+struct BenchOptions {
+    size_t warmup = 0;          // --warmup W: untimed runs of each repeated phase
+    size_t trials = 1;          // --trials N: timed runs of each repeated phase
+    std::string json_path;      // --bench-json PATH: write every phase's statistics as JSON
+    std::string csv_path;       // --bench-csv PATH: ... as CSV, one row per phase
+    bool perf = false;          // --perf: hardware counters per phase, see pir_perf.h
+    std::string trace_path;     // --trace PATH: write a Chrome trace of every trial, see pir_trace.h
+};
+
+inline void print_bench_usage(const char* program) {
+    std::cout << "       " << program << " [--warmup W] [--trials N] [--bench-json PATH] [--bench-csv PATH] [--perf] [--trace PATH]" << std::endl;
+}
+
+// parses argv[i] (and its value) into opts; returns false if it is not a benchmark option
+inline bool parse_bench_option(int argc, char* argv[], int& i, BenchOptions& opts) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--warmup" && has_value) {
+        opts.warmup = std::stoul(argv[++i]);
+    } else if (arg == "--trials" && has_value) {
+        opts.trials = std::max<size_t>(std::stoul(argv[++i]), 1);
+    } else if (arg == "--bench-json" && has_value) {
+        opts.json_path = argv[++i];
+    } else if (arg == "--bench-csv" && has_value) {
+        opts.csv_path = argv[++i];
+    } else if (arg == "--perf") {
+        opts.perf = true;
+    } else if (arg == "--trace" && has_value) {
+        opts.trace_path = argv[++i];
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline double process_cpu_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct BenchSample {
+    double wall = 0;    // seconds
+    double cpu = 0;     // seconds of process CPU time, all threads
+    PerfSample perf;    // only with --perf
+};
+
+// wall and CPU time since construction (or the last restart)
+class PhaseTimer {
+public:
+    PhaseTimer() { restart(); }
+
+    void restart() {
+        wall_start_ = std::chrono::steady_clock::now();
+        cpu_start_ = process_cpu_seconds();
+    }
+
+    BenchSample elapsed() const {
+        BenchSample s;
+        s.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start_).count();
+        s.cpu = process_cpu_seconds() - cpu_start_;
+        return s;
+    }
+
+private:
+    std::chrono::steady_clock::time_point wall_start_;
+    double cpu_start_;
+};
+
+struct SampleStats {
+    double min = 0;
+    double median = 0;
+    double p95 = 0;
+    double p99 = 0;
+    double mean = 0;
+};
+
+// nearest-rank percentiles, so every reported value is one that was actually measured
+inline SampleStats sample_stats(std::vector<double> samples) {
+    SampleStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&](double p) {
+        size_t r = (size_t)std::ceil(p * samples.size());
+        return samples[std::min(std::max<size_t>(r, 1), samples.size()) - 1];
+    };
+    stats.min = samples.front();
+    stats.median = rank(0.5);
+    stats.p95 = rank(0.95);
+    stats.p99 = rank(0.99);
+    for (double s : samples) {
+        stats.mean += s;
+    }
+    stats.mean /= samples.size();
+    return stats;
+}
+
+struct PhaseStats {
+    std::string name;
+    size_t trials = 0;
+    SampleStats wall;
+    SampleStats cpu;
+};
+
+// medians over the trials that read the counters; llc_miss_gbps is LLC miss bytes per wall second
+struct PerfStats {
+    size_t trials = 0;
+    double median[perf_event_count] = {};
+    bool valid[perf_event_count] = {};
+    double ipc = 0;
+    double llc_miss_gbps = 0;
+};
+
+class BenchHarness {
+public:
+    BenchHarness(const std::string& program, const BenchOptions& opts = BenchOptions()) : program_(program), opts_(opts) {
+        if (opts_.perf) {
+            perf_.reset(new PerfCounters());
+        }
+        if (!opts_.trace_path.empty()) {
+            Tracer::instance().enable();
+            trace_thread_name("main");
+        }
+    }
+
+    // run-wide parameters (n, t, db_len, ...) carried into the JSON report
+    void note(const std::string& key, const std::string& value) { notes_.push_back({key, "\"" + json_escape(value) + "\""}); }
+    template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    void note(const std::string& key, T value) {
+        std::ostringstream ss;
+        ss.precision(17);
+        ss << value;
+        notes_.push_back({key, ss.str()});
+    }
+
+    // runs fn warmup times, then trials times under the timer. fn may return an int status;
+    // a nonzero status stops the phase and is returned. Whatever the last run leaves behind
+    // (the response, the query, ...) is what the caller goes on with, so fn must be repeatable
+    template <typename F>
+    int run(const std::string& phase, F&& fn) {
+        for (size_t w = 0; w < opts_.warmup; w++) {
+            if (int status = invoke(fn)) {
+                return status;
+            }
+        }
+        const char* trace_name = Tracer::instance().enabled() ? Tracer::instance().intern(phase) : "";
+        for (size_t r = 0; r < opts_.trials; r++) {
+            if (perf_) {
+                perf_->start();
+            }
+            int status;
+            BenchSample sample;
+            {
+                TraceScope span(trace_name, (int64_t)r);
+                PhaseTimer timer;
+                status = invoke(fn);
+                sample = timer.elapsed();
+            }
+            if (perf_) {
+                sample.perf = perf_->stop();
+            }
+            if (status) {
+                return status;
+            }
+            record(phase, sample);
+        }
+        return 0;
+    }
+
+    // adds one sample measured by the caller, for phases that cannot be repeated
+    void record(const std::string& phase, const BenchSample& sample) {
+        for (auto& p : phases_) {
+            if (p.first == phase) {
+                p.second.push_back(sample);
+                return;
+            }
+        }
+        phases_.push_back({phase, {sample}});
+    }
+
+    PhaseStats stats(const std::string& phase) const {
+        PhaseStats stats;
+        stats.name = phase;
+        for (const auto& p : phases_) {
+            if (p.first == phase) {
+                std::vector<double> wall, cpu;
+                for (const auto& s : p.second) {
+                    wall.push_back(s.wall);
+                    cpu.push_back(s.cpu);
+                }
+                stats.trials = p.second.size();
+                stats.wall = sample_stats(wall);
+                stats.cpu = sample_stats(cpu);
+            }
+        }
+        return stats;
+    }
+
+    PerfStats perf_stats(const std::string& phase) const {
+        PerfStats stats;
+        for (const auto& p : phases_) {
+            if (p.first != phase) {
+                continue;
+            }
+            std::vector<double> counts[perf_event_count], ipc, gbps;
+            for (const auto& s : p.second) {
+                for (int e = 0; e < perf_event_count; e++) {
+                    if (s.perf.valid[e]) {
+                        counts[e].push_back((double)s.perf.value[e]);
+                    }
+                }
+                if (s.perf.valid[perf_cycles] && s.perf.valid[perf_instructions]) {
+                    ipc.push_back(s.perf.ipc());
+                }
+                if (s.perf.valid[perf_llc_misses] && s.wall > 0) {
+                    gbps.push_back(s.perf.llc_miss_bytes() / s.wall * 1e-9);
+                }
+            }
+            for (int e = 0; e < perf_event_count; e++) {
+                stats.valid[e] = !counts[e].empty();
+                stats.median[e] = sample_stats(counts[e]).median;
+                stats.trials = std::max(stats.trials, counts[e].size());
+            }
+            stats.ipc = sample_stats(ipc).median;
+            stats.llc_miss_gbps = sample_stats(gbps).median;
+        }
+        return stats;
+    }
+
+    // median wall time of a phase, what the programs print as "Time to ..."
+    double median(const std::string& phase) const { return stats(phase).wall.median; }
+
+    std::vector<PhaseStats> all_stats() const {
+        std::vector<PhaseStats> all;
+        for (const auto& p : phases_) {
+            all.push_back(stats(p.first));
+        }
+        return all;
+    }
+
+    void print_summary() const {
+        std::cout << "Benchmark summary (wall clock, " << opts_.warmup << " warm-up, " << opts_.trials << " trials):" << std::endl;
+        printf("%-24s %7s %12s %12s %12s %12s %12s\n", "phase", "trials", "min (s)", "median (s)", "p95 (s)", "p99 (s)", "cpu med (s)");
+        for (const auto& s : all_stats()) {
+            printf("%-24s %7zu %12f %12f %12f %12f %12f\n", s.name.c_str(), s.trials, s.wall.min, s.wall.median,
+                   s.wall.p95, s.wall.p99, s.cpu.median);
+        }
+        if (!perf_) {
+            return;
+        }
+        std::cout << "Hardware counters (median per trial):" << std::endl;
+        printf("%-24s %14s %14s %6s %12s %12s %10s\n", "phase", "cycles", "instructions", "IPC", "LLC misses", "dTLB misses",
+               "LLC GB/s");
+        for (const auto& p : phases_) {
+            PerfStats s = perf_stats(p.first);
+            if (s.trials == 0) {
+                continue;
+            }
+            printf("%-24s %14.0f %14.0f %6.2f %12.0f %12.0f %10.2f\n", p.first.c_str(), s.median[perf_cycles],
+                   s.median[perf_instructions], s.ipc, s.median[perf_llc_misses], s.median[perf_dtlb_misses], s.llc_miss_gbps);
+        }
+    }
+
+    int write_json(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "ERROR: Could not write " << path << std::endl;
+            return -1;
+        }
+        out.precision(9);
+        out << "{\n  \"program\": \"" << json_escape(program_) << "\",\n";
+        out << "  \"warmup\": " << opts_.warmup << ",\n  \"trials\": " << opts_.trials << ",\n";
+        out << "  \"params\": {";
+        for (size_t i = 0; i < notes_.size(); i++) {
+            out << (i ? ", " : "") << "\"" << json_escape(notes_[i].first) << "\": " << notes_[i].second;
+        }
+        out << "},\n  \"phases\": [";
+        for (size_t i = 0; i < phases_.size(); i++) {
+            PhaseStats s = stats(phases_[i].first);
+            out << (i ? "," : "") << "\n    {\"name\": \"" << json_escape(s.name) << "\", \"trials\": " << s.trials;
+            out << ", \"wall_s\": ";
+            write_json_stats(out, s.wall);
+            out << ", \"cpu_s\": ";
+            write_json_stats(out, s.cpu);
+            if (perf_) {
+                out << ", \"perf\": ";
+                write_json_perf(out, perf_stats(s.name));
+            }
+            out << ", \"samples_wall_s\": [";
+            for (size_t j = 0; j < phases_[i].second.size(); j++) {
+                out << (j ? ", " : "") << phases_[i].second[j].wall;
+            }
+            out << "]}";
+        }
+        out << "\n  ]\n}\n";
+        return 0;
+    }
+
+    int write_csv(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "ERROR: Could not write " << path << std::endl;
+            return -1;
+        }
+        out.precision(9);
+        out << "program,phase,trials,wall_min_s,wall_median_s,wall_p95_s,wall_p99_s,wall_mean_s,"
+            << "cpu_min_s,cpu_median_s,cpu_p95_s,cpu_p99_s,cpu_mean_s\n";
+        for (const auto& s : all_stats()) {
+            out << program_ << "," << s.name << "," << s.trials << "," << s.wall.min << "," << s.wall.median << ","
+                << s.wall.p95 << "," << s.wall.p99 << "," << s.wall.mean << "," << s.cpu.min << "," << s.cpu.median << ","
+                << s.cpu.p95 << "," << s.cpu.p99 << "," << s.cpu.mean << "\n";
+        }
+        return 0;
+    }
+
+    // summary on stdout, then whichever reports were asked for on the command line
+    int report() const {
+        print_summary();
+        if (!opts_.json_path.empty() && write_json(opts_.json_path) != 0) {
+            return -1;
+        }
+        if (!opts_.csv_path.empty() && write_csv(opts_.csv_path) != 0) {
+            return -1;
+        }
+        if (!opts_.trace_path.empty() && Tracer::instance().write(opts_.trace_path) != 0) {
+            return -1;
+        }
+        return 0;
+    }
+
+    const BenchOptions& options() const { return opts_; }
+
+private:
+    template <typename F>
+    static int invoke(F& fn) {
+        if constexpr (std::is_void<decltype(fn())>::value) {
+            fn();
+            return 0;
+        } else {
+            return fn();
+        }
+    }
+
+    static std::string json_escape(const std::string& s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+            out += c;
+        }
+        return out;
+    }
+
+    static void write_json_stats(std::ostream& out, const SampleStats& s) {
+        out << "{\"min\": " << s.min << ", \"median\": " << s.median << ", \"p95\": " << s.p95
+            << ", \"p99\": " << s.p99 << ", \"mean\": " << s.mean << "}";
+    }
+
+    // counters a phase never read (single-sample phases) or the kernel refused are null
+    static void write_json_perf(std::ostream& out, const PerfStats& s) {
+        if (s.trials == 0) {
+            out << "null";
+            return;
+        }
+        out << "{\"trials\": " << s.trials;
+        for (int e = 0; e < perf_event_count; e++) {
+            out << ", \"" << perf_event_name(e) << "\": ";
+            if (s.valid[e]) {
+                out << (uint64_t)s.median[e];
+            } else {
+                out << "null";
+            }
+        }
+        out << ", \"ipc\": ";
+        if (s.valid[perf_cycles] && s.valid[perf_instructions]) {
+            out << s.ipc;
+        } else {
+            out << "null";
+        }
+        out << ", \"llc_miss_gbps\": ";
+        if (s.valid[perf_llc_misses]) {
+            out << s.llc_miss_gbps;
+        } else {
+            out << "null";
+        }
+        out << "}";
+    }
+
+    std::string program_;
+    BenchOptions opts_;
+    std::unique_ptr<PerfCounters> perf_;
+    std::vector<std::pair<std::string, std::string>> notes_;    // key, JSON value
+    std::vector<std::pair<std::string, std::vector<BenchSample>>> phases_;
+};
@@ -0,0 +1,386 @@
+#pragma once
+
+#include "seal/seal.h"
+#include "seal/util/ntt.h"
+#include "seal/util/polyarithsmallmod.h"
+#include "seal/util/rns.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+On-disk layout of a pre-encoded PIR database (all fields little endian uint64 unless noted):
+
+    [PIRDBHeader, padded to PIR_DB_ALIGN bytes]
+    [rows * cols plaintext slots, each slot_coeffs words, row major]
+
+The payload starts on a page boundary so the file can be mmap'd and every slot read in
+place. A slot holds either the raw plaintext coefficients (zero padded to slot_coeffs) or,
+when PIR_DB_NTT_FORM is set, the plaintext already lifted and transformed to NTT form at
+parms_id, i.e. poly_modulus_degree * coeff_modulus_size words.
+*/
+
+constexpr char PIR_DB_MAGIC[8] = {'B', 'F', 'V', 'P', 'I', 'R', 'D', 'B'};
+constexpr uint32_t PIR_DB_VERSION = 1;
+constexpr uint32_t PIR_DB_NTT_FORM = 1;
+constexpr size_t PIR_DB_MAX_MODULI = 64;
+constexpr size_t PIR_DB_ALIGN = 4096;
+
+struct PIRDBHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t poly_modulus_degree;
+    uint64_t plain_modulus;
+    uint64_t coeff_modulus_size;
+    uint64_t coeff_modulus[PIR_DB_MAX_MODULI];
+    uint64_t parms_id[4];
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t slot_coeffs;
+    uint64_t data_offset;
+    uint64_t data_bytes;
+    uint64_t checksum;
+};
+
+static_assert(sizeof(PIRDBHeader) <= PIR_DB_ALIGN, "PIR database header must fit in the first page");
+
+// 64-bit FNV-1a, folded one word at a time so multi-GB payloads hash at memory speed
+inline uint64_t pir_db_checksum(const uint64_t* words, size_t count, uint64_t hash = 0xcbf29ce484222325ULL) {
+    for (size_t i = 0; i < count; i++) {
+        hash ^= words[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// writes data (rows of plaintexts) to path; with ntt_form every plaintext is stored already
+// transformed to NTT form at parms_id so the server can skip encoding entirely at startup
+inline int write_pir_db(const std::string& path, const seal::SEALContext& context, const std::vector<std::vector<seal::Plaintext>>& data,
+                        bool ntt_form, seal::Evaluator* evaluator, seal::parms_id_type parms_id) {
+    auto context_data = context.get_context_data(parms_id);
+    if (!context_data || data.empty()) {
+        std::cout << "ERROR: Invalid parms_id or empty database" << std::endl;
+        return -1;
+    }
+    const seal::EncryptionParameters& parms = context_data->parms();
+    size_t n = parms.poly_modulus_degree();
+    size_t coeff_modulus_size = parms.coeff_modulus().size();
+
+    PIRDBHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, PIR_DB_MAGIC, sizeof(header.magic));
+    header.version = PIR_DB_VERSION;
+    header.flags = ntt_form ? PIR_DB_NTT_FORM : 0;
+    header.poly_modulus_degree = n;
+    header.plain_modulus = parms.plain_modulus().value();
+    header.coeff_modulus_size = coeff_modulus_size;
+    for (size_t i = 0; i < coeff_modulus_size; i++) {
+        header.coeff_modulus[i] = parms.coeff_modulus()[i].value();
+    }
+    std::copy(parms_id.begin(), parms_id.end(), header.parms_id);
+    header.rows = data.size();
+    header.cols = data[0].size();
+
+    if (ntt_form) {
+        header.slot_coeffs = n * coeff_modulus_size;
+    } else {
+        for (auto& row : data) {
+            for (auto& pt : row) {
+                header.slot_coeffs = std::max<uint64_t>(header.slot_coeffs, pt.coeff_count());
+            }
+        }
+    }
+    header.data_offset = PIR_DB_ALIGN;
+    header.data_bytes = header.rows * header.cols * header.slot_coeffs * sizeof(uint64_t);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "ERROR: Could not open " << path << " for writing" << std::endl;
+        return -1;
+    }
+    // header is rewritten with the checksum once the payload is out
+    std::vector<char> page(PIR_DB_ALIGN, 0);
+    out.write(page.data(), page.size());
+
+    std::vector<uint64_t> slot(header.slot_coeffs);
+    uint64_t checksum = pir_db_checksum(nullptr, 0);
+    for (auto& row : data) {
+        if (row.size() != header.cols) {
+            std::cout << "ERROR: Database rows must all have the same length" << std::endl;
+            return -1;
+        }
+        for (auto& pt : row) {
+            std::fill(slot.begin(), slot.end(), 0);
+            if (ntt_form) {
+                seal::Plaintext pt_ntt;
+                evaluator->transform_to_ntt(pt, parms_id, pt_ntt);
+                std::copy(pt_ntt.data(), pt_ntt.data() + header.slot_coeffs, slot.begin());
+            } else {
+                std::copy(pt.data(), pt.data() + pt.coeff_count(), slot.begin());
+            }
+            checksum = pir_db_checksum(slot.data(), slot.size(), checksum);
+            out.write(reinterpret_cast<const char*>(slot.data()), slot.size() * sizeof(uint64_t));
+        }
+    }
+    header.checksum = checksum;
+
+    std::memcpy(page.data(), &header, sizeof(header));
+    out.seekp(0);
+    out.write(page.data(), page.size());
+    if (!out) {
+        std::cout << "ERROR: Failed writing " << path << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+inline seal::parms_id_type pir_db_parms_id(const PIRDBHeader& header) {
+    seal::parms_id_type id;
+    std::copy(header.parms_id, header.parms_id + 4, id.begin());
+    return id;
+}
+
+// checks a header read from a file of file_len bytes against the context it will be used with
+inline int validate_pir_db_header(const PIRDBHeader& header, size_t file_len, const seal::SEALContext& context) {
+    if (std::memcmp(header.magic, PIR_DB_MAGIC, sizeof(header.magic)) != 0) {
+        std::cout << "ERROR: Bad magic in PIR database file" << std::endl;
+        return -1;
+    }
+    if (header.version != PIR_DB_VERSION) {
+        std::cout << "ERROR: Unsupported PIR database version " << header.version << std::endl;
+        return -1;
+    }
+    auto context_data = context.get_context_data(pir_db_parms_id(header));
+    if (!context_data) {
+        std::cout << "ERROR: PIR database was encoded for different encryption parameters" << std::endl;
+        return -1;
+    }
+    const seal::EncryptionParameters& parms = context_data->parms();
+    bool match = header.poly_modulus_degree == parms.poly_modulus_degree() &&
+                 header.plain_modulus == parms.plain_modulus().value() &&
+                 header.coeff_modulus_size == parms.coeff_modulus().size();
+    for (size_t i = 0; match && i < header.coeff_modulus_size; i++) {
+        match = header.coeff_modulus[i] == parms.coeff_modulus()[i].value();
+    }
+    if (!match) {
+        std::cout << "ERROR: PIR database header does not match encryption parameters" << std::endl;
+        return -1;
+    }
+    if (header.data_offset + header.data_bytes > file_len ||
+        header.data_bytes != header.rows * header.cols * header.slot_coeffs * sizeof(uint64_t)) {
+        std::cout << "ERROR: PIR database file is truncated" << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+// read-only view of a database file; the mapping is MAP_SHARED so every server process
+// opening the same file scans the same page-cache copy
+class MappedPIRDatabase {
+public:
+    MappedPIRDatabase() = default;
+    MappedPIRDatabase(const MappedPIRDatabase&) = delete;
+    MappedPIRDatabase& operator=(const MappedPIRDatabase&) = delete;
+    ~MappedPIRDatabase() { close(); }
+
+    int open(const std::string& path, const seal::SEALContext& context, bool verify_checksum = false) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cout << "ERROR: Could not open " << path << std::endl;
+            return -1;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < PIR_DB_ALIGN) {
+            std::cout << "ERROR: " << path << " is not a PIR database file" << std::endl;
+            ::close(fd);
+            return -1;
+        }
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) {
+            std::cout << "ERROR: Could not mmap " << path << std::endl;
+            return -1;
+        }
+        base_ = static_cast<const char*>(addr);
+        map_len_ = st.st_size;
+        std::memcpy(&header_, base_, sizeof(header_));
+
+        if (validate_pir_db_header(header_, map_len_, context) != 0) {
+            close();
+            return -1;
+        }
+        madvise(const_cast<char*>(base_) + header_.data_offset, header_.data_bytes, MADV_SEQUENTIAL);
+
+        if (verify_checksum &&
+            pir_db_checksum(slot(0, 0), header_.data_bytes / sizeof(uint64_t)) != header_.checksum) {
+            std::cout << "ERROR: Checksum mismatch in " << path << std::endl;
+            close();
+            return -1;
+        }
+        return 0;
+    }
+
+    void close() {
+        if (base_) {
+            munmap(const_cast<char*>(base_), map_len_);
+        }
+        base_ = nullptr;
+        map_len_ = 0;
+    }
+
+    const PIRDBHeader& header() const { return header_; }
+    size_t rows() const { return header_.rows; }
+    size_t cols() const { return header_.cols; }
+    size_t slot_coeffs() const { return header_.slot_coeffs; }
+    bool is_ntt_form() const { return header_.flags & PIR_DB_NTT_FORM; }
+    seal::parms_id_type parms_id() const { return pir_db_parms_id(header_); }
+
+    const uint64_t* slot(size_t row, size_t col) const {
+        return reinterpret_cast<const uint64_t*>(base_ + header_.data_offset) + (row * header_.cols + col) * header_.slot_coeffs;
+    }
+
+    // copies one slot out as a coefficient-form Plaintext. An NTT-form slot is transformed back
+    // one RNS component at a time and the components CRT-composed. transform_to_ntt lifted every
+    // coefficient x >= (t + 1) / 2 to x + (q - t) first, so a composed value at or above that
+    // threshold has q - t taken off again; the result is below t, so the low words suffice.
+    seal::Plaintext plaintext(size_t row, size_t col, const seal::SEALContext& context) const {
+        if (!is_ntt_form()) {
+            seal::Plaintext pt(header_.slot_coeffs);
+            std::copy(slot(row, col), slot(row, col) + header_.slot_coeffs, pt.data());
+            return pt;
+        }
+
+        auto context_data = context.get_context_data(parms_id());
+        size_t n = header_.poly_modulus_degree;
+        size_t coeff_modulus_size = header_.coeff_modulus_size;
+        std::vector<uint64_t> coeffs(slot(row, col), slot(row, col) + n * coeff_modulus_size);
+        for (size_t i = 0; i < coeff_modulus_size; i++) {
+            seal::util::inverse_ntt_negacyclic_harvey(coeffs.data() + i * n, context_data->small_ntt_tables()[i]);
+        }
+        // composes in place into n multi-word integers of coeff_modulus_size words each
+        context_data->rns_tool()->base_q()->compose_array(coeffs.data(), n, seal::MemoryManager::GetPool());
+
+        uint64_t threshold = context_data->plain_upper_half_threshold();
+        uint64_t q_low = context_data->rns_tool()->base_q()->base_prod()[0];
+        uint64_t t = header_.plain_modulus;
+        seal::Plaintext pt(n);
+        for (size_t j = 0; j < n; j++) {
+            const uint64_t* value = coeffs.data() + j * coeff_modulus_size;
+            bool upper = value[0] >= threshold;
+            for (size_t k = 1; k < coeff_modulus_size && !upper; k++) {
+                upper = value[k] != 0;
+            }
+            // value - (q - t), exact in the low word because the difference is below t
+            pt[j] = upper ? value[0] - q_low + t : value[0];
+        }
+        return pt;
+    }
+
+private:
+    PIRDBHeader header_{};
+    const char* base_ = nullptr;
+    size_t map_len_ = 0;
+};
+
+// accumulates query[j] * slot_j over the slots of one database row. NTT-form slots need the
+// query in NTT form too: every term is then a dyadic product accumulated in place, and a
+// single inverse NTT finishes the row.
+class SlotAccumulator {
+public:
+    SlotAccumulator(const seal::SEALContext& context, seal::Evaluator* evaluator, const PIRDBHeader& header)
+        : context_(context), evaluator_(evaluator), header_(header) {
+        auto context_data = context.get_context_data(pir_db_parms_id(header));
+        coeff_modulus_ = context_data->parms().coeff_modulus();
+        n_ = context_data->parms().poly_modulus_degree();
+        temp_.resize(n_);
+    }
+
+    void add(const seal::Ciphertext& query_ct, const uint64_t* slot) {
+        if (!(header_.flags & PIR_DB_NTT_FORM)) {
+            seal::Plaintext pt(header_.slot_coeffs);
+            std::copy(slot, slot + header_.slot_coeffs, pt.data());
+            if (empty_) {
+                evaluator_->multiply_plain(query_ct, pt, result_);
+            } else {
+                evaluator_->multiply_plain(query_ct, pt, temp_ct_);
+                evaluator_->add_inplace(result_, temp_ct_);
+            }
+            empty_ = false;
+            return;
+        }
+
+        for (size_t i = 0; i < coeff_modulus_.size(); i++) {
+            add_component(query_ct, slot, i);
+        }
+    }
+
+    // NTT-form only: accumulates RNS component i of query_ct * slot, so a caller can run one
+    // component of a slot through several accumulators while it is still in cache
+    void add_component(const seal::Ciphertext& query_ct, const uint64_t* slot, size_t i) {
+        if (empty_) {
+            result_.resize(context_, pir_db_parms_id(header_), query_ct.size());
+            result_.is_ntt_form() = true;
+            for (size_t p = 0; p < result_.size(); p++) {
+                std::fill(result_.data(p), result_.data(p) + n_ * coeff_modulus_.size(), 0);
+            }
+            empty_ = false;
+        }
+        for (size_t p = 0; p < result_.size(); p++) {
+            uint64_t* acc = result_.data(p) + i * n_;
+            seal::util::dyadic_product_coeffmod(query_ct.data(p) + i * n_, slot + i * n_, n_, coeff_modulus_[i], temp_.data());
+            seal::util::add_poly_coeffmod(acc, temp_.data(), n_, coeff_modulus_[i], acc);
+        }
+    }
+
+    size_t coeff_modulus_size() const { return coeff_modulus_.size(); }
+
+    // returns the finished row in coefficient form and resets for the next one
+    seal::Ciphertext finish() {
+        if (!empty_ && result_.is_ntt_form()) {
+            evaluator_->transform_from_ntt_inplace(result_);
+        }
+        empty_ = true;
+        // swap rather than move so result_ keeps a valid memory pool for the next row
+        seal::Ciphertext out;
+        std::swap(out, result_);
+        return out;
+    }
+
+private:
+    const seal::SEALContext& context_;
+    seal::Evaluator* evaluator_;
+    PIRDBHeader header_;
+    std::vector<seal::Modulus> coeff_modulus_;
+    size_t n_;
+    std::vector<uint64_t> temp_;
+    seal::Ciphertext temp_ct_;
+    seal::Ciphertext result_;
+    bool empty_ = true;
+};
+
+// dot product of query with one database row, reading slots straight out of the mapping
+inline seal::Ciphertext dot_product_mapped(const std::vector<seal::Ciphertext>& query, const MappedPIRDatabase& db, size_t row,
+                                           const seal::SEALContext& context, seal::Evaluator* evaluator) {
+    size_t len = db.cols();
+    if (len < 1 || query.size() < len) {
+        std::cout << "ERROR: Query shorter than database row" << std::endl;
+        return seal::Ciphertext();
+    }
+
+    SlotAccumulator acc(context, evaluator, db.header());
+    for (size_t j = 0; j < len; j++) {
+        acc.add(query[j], db.slot(row, j));
+    }
+    return acc.finish();
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "seal/seal.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+/*
+Fused BFV inner product sum_j a[j] * b[j]. Evaluator::multiply runs the full BEHZ pipeline
+for every product: extend both operands from base q to base Bsk and NTT them, tensor, inverse
+NTT, then scale by t/q and convert back to base q. The tensor is linear and only the final
+sum is decrypted, so here the tensors of all pairs are accumulated in NTT form in q and Bsk,
+and the inverse NTT and scale-and-round run once at the end. The per-pair cost drops to the
+forward base extensions and the dyadic products, and the result carries one rounding error
+instead of len of them.
+*/
+
+// base extension of one ciphertext polynomial (coefficient form, base q) to NTT form in q and in Bsk
+inline void fused_extend_to_ntt(const uint64_t* poly, const seal::SEALContext::ContextData& context_data,
+                                uint64_t* out_q, uint64_t* out_Bsk, uint64_t* temp_Bsk_m_tilde, seal::MemoryPoolHandle pool) {
+    const auto& parms = context_data.parms();
+    size_t n = parms.poly_modulus_degree();
+    size_t q_size = parms.coeff_modulus().size();
+    auto rns_tool = context_data.rns_tool();
+    size_t Bsk_size = rns_tool->base_Bsk()->size();
+
+    std::copy(poly, poly + n * q_size, out_q);
+    for (size_t i = 0; i < q_size; i++) {
+        seal::util::ntt_negacyclic_harvey(out_q + i * n, context_data.small_ntt_tables()[i]);
+    }
+    // q -> Bsk U {m_tilde}, then Montgomery reduction of the q-overflows down to Bsk
+    rns_tool->fastbconv_m_tilde(seal::util::ConstRNSIter(poly, n), seal::util::RNSIter(temp_Bsk_m_tilde, n), pool);
+    rns_tool->sm_mrq(seal::util::ConstRNSIter(temp_Bsk_m_tilde, n), seal::util::RNSIter(out_Bsk, n), pool);
+    for (size_t i = 0; i < Bsk_size; i++) {
+        seal::util::ntt_negacyclic_harvey(out_Bsk + i * n, rns_tool->base_Bsk_ntt_tables()[i]);
+    }
+}
+
+// same result as vector_dot_cc (up to rounding), which it replaces for coefficient form ciphertexts at one level
+inline int vector_dot_cc_fused(const std::vector<seal::Ciphertext>& a, const std::vector<seal::Ciphertext>& b, size_t len,
+                               const seal::SEALContext& context, seal::Ciphertext& result,
+                               seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool()) {
+    if (len < 1) {
+        std::cout << "ERROR: Vector length should be greater than or equal to 1" << std::endl;
+        return -1;
+    }
+    auto context_data_ptr = context.get_context_data(a[0].parms_id());
+    const auto& context_data = *context_data_ptr;
+    const auto& parms = context_data.parms();
+    const auto& base_q = parms.coeff_modulus();
+    auto rns_tool = context_data.rns_tool();
+    const seal::Modulus* base_Bsk = rns_tool->base_Bsk()->base();
+    size_t n = parms.poly_modulus_degree();
+    size_t q_size = base_q.size();
+    size_t Bsk_size = rns_tool->base_Bsk()->size();
+    size_t Bsk_m_tilde_size = rns_tool->base_Bsk_m_tilde()->size();
+    uint64_t plain_modulus = parms.plain_modulus().value();
+
+    // the accumulated tensor is scaled by t before fast_floor, and t times it must stay below
+    // q * Bsk / 2. After sm_mrq each extended coefficient is below (q_size + 2) * q / 2 in size,
+    // so one product needs q * n * (q_size + 2)^2 of it, every doubling of len one more bit and
+    // the scaling log2 t bits
+    int q_bits = 0;
+    int Bsk_bits = 0;
+    for (size_t i = 0; i < q_size; i++) {
+        q_bits += base_q[i].bit_count();
+    }
+    for (size_t i = 0; i < Bsk_size; i++) {
+        Bsk_bits += base_Bsk[i].bit_count() - 1;
+    }
+    int headroom = Bsk_bits - q_bits - 2 - parms.plain_modulus().bit_count();
+    for (size_t m = (q_size + 2) * (q_size + 2); m > 1; m >>= 1) {
+        headroom--;
+    }
+    for (size_t m = n * len; m > 1; m >>= 1) {
+        headroom--;
+    }
+    if (headroom < 0) {
+        std::cout << "ERROR: Inner product too long to accumulate in base Bsk" << std::endl;
+        return -1;
+    }
+
+    size_t dest_size = 0;
+    for (size_t j = 0; j < len; j++) {
+        if (a[j].is_ntt_form() || b[j].is_ntt_form() || a[j].parms_id() != a[0].parms_id() || b[j].parms_id() != a[0].parms_id()) {
+            std::cout << "ERROR: Fused inner product needs coefficient form ciphertexts at one level" << std::endl;
+            return -1;
+        }
+        dest_size = std::max(dest_size, a[j].size() + b[j].size() - 1);
+    }
+
+    size_t q_poly = n * q_size;
+    size_t Bsk_poly = n * Bsk_size;
+    std::vector<uint64_t> acc_q(dest_size * q_poly, 0);
+    std::vector<uint64_t> acc_Bsk(dest_size * Bsk_poly, 0);
+    std::vector<uint64_t> a_q, a_Bsk, b_q, b_Bsk;
+    std::vector<uint64_t> temp_Bsk_m_tilde(n * Bsk_m_tilde_size);
+    std::vector<uint64_t> prod(n);
+
+    for (size_t j = 0; j < len; j++) {
+        size_t a_size = a[j].size();
+        size_t b_size = b[j].size();
+        a_q.resize(a_size * q_poly);
+        a_Bsk.resize(a_size * Bsk_poly);
+        b_q.resize(b_size * q_poly);
+        b_Bsk.resize(b_size * Bsk_poly);
+        for (size_t p = 0; p < a_size; p++) {
+            fused_extend_to_ntt(a[j].data(p), context_data, a_q.data() + p * q_poly, a_Bsk.data() + p * Bsk_poly, temp_Bsk_m_tilde.data(), pool);
+        }
+        for (size_t p = 0; p < b_size; p++) {
+            fused_extend_to_ntt(b[j].data(p), context_data, b_q.data() + p * q_poly, b_Bsk.data() + p * Bsk_poly, temp_Bsk_m_tilde.data(), pool);
+        }
+
+        // tensor: acc[p1 + p2] += a[p1] * b[p2], component-wise in both bases
+        for (size_t p1 = 0; p1 < a_size; p1++) {
+            for (size_t p2 = 0; p2 < b_size; p2++) {
+                size_t d = p1 + p2;
+                for (size_t i = 0; i < q_size; i++) {
+                    uint64_t* acc = acc_q.data() + d * q_poly + i * n;
+                    seal::util::dyadic_product_coeffmod(a_q.data() + p1 * q_poly + i * n, b_q.data() + p2 * q_poly + i * n, n, base_q[i], prod.data());
+                    seal::util::add_poly_coeffmod(acc, prod.data(), n, base_q[i], acc);
+                }
+                for (size_t i = 0; i < Bsk_size; i++) {
+                    uint64_t* acc = acc_Bsk.data() + d * Bsk_poly + i * n;
+                    seal::util::dyadic_product_coeffmod(a_Bsk.data() + p1 * Bsk_poly + i * n, b_Bsk.data() + p2 * Bsk_poly + i * n, n, base_Bsk[i], prod.data());
+                    seal::util::add_poly_coeffmod(acc, prod.data(), n, base_Bsk[i], acc);
+                }
+            }
+        }
+    }
+
+    // one inverse NTT and one scale-and-round (BEHZ steps 5-8) for the whole sum
+    result.resize(context, context_data.parms_id(), dest_size);
+    std::vector<uint64_t> temp_q_Bsk(q_poly + Bsk_poly);
+    std::vector<uint64_t> temp_Bsk(Bsk_poly);
+    for (size_t d = 0; d < dest_size; d++) {
+        for (size_t i = 0; i < q_size; i++) {
+            uint64_t* poly = acc_q.data() + d * q_poly + i * n;
+            seal::util::inverse_ntt_negacyclic_harvey(poly, context_data.small_ntt_tables()[i]);
+            seal::util::multiply_poly_scalar_coeffmod(poly, n, plain_modulus, base_q[i], temp_q_Bsk.data() + i * n);
+        }
+        for (size_t i = 0; i < Bsk_size; i++) {
+            uint64_t* poly = acc_Bsk.data() + d * Bsk_poly + i * n;
+            seal::util::inverse_ntt_negacyclic_harvey(poly, rns_tool->base_Bsk_ntt_tables()[i]);
+            seal::util::multiply_poly_scalar_coeffmod(poly, n, plain_modulus, base_Bsk[i], temp_q_Bsk.data() + q_poly + i * n);
+        }
+        rns_tool->fast_floor(seal::util::ConstRNSIter(temp_q_Bsk.data(), n), seal::util::RNSIter(temp_Bsk.data(), n), pool);
+        rns_tool->fastbconv_sk(seal::util::ConstRNSIter(temp_Bsk.data(), n), seal::util::RNSIter(result.data(d), n), pool);
+    }
+    return 0;
+}
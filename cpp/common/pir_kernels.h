@@ -0,0 +1,311 @@
+#pragma once
+
+#include "seal/seal.h"
+#include "seal/util/polyarithsmallmod.h"
+#include "pir_trace.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// PIR client and server kernels shared by the TrivialPR and VectorPR binaries
+
+// populates client array
+inline int client_populate(std::vector<seal::Ciphertext>& client_array, size_t len, size_t index, seal::Encryptor* encryptor) {
+    seal::Ciphertext encrypted_zero;
+    seal::Ciphertext encrypted_one;
+
+    encryptor->encrypt_symmetric(seal::Plaintext("0"), encrypted_zero);
+    encryptor->encrypt_symmetric(seal::Plaintext("1"), encrypted_one);
+
+    for (size_t i = 0; i < len; i++) {
+        client_array[i] = encrypted_zero;
+        if (i == index) {
+            client_array[i] = encrypted_one;
+        }
+    }
+    return 0;
+}
+
+// TrivialPR: dot product of the encrypted selection vector with the whole database.
+// Every allocation, including the result's, comes from pool.
+inline seal::Ciphertext server_compute(std::vector<seal::Plaintext>& data, std::vector<seal::Ciphertext>& client_array, size_t len, seal::Evaluator* evaluator, seal::Decryptor* d,
+                                       seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool()) {
+    TraceScope span("dot_product");
+    seal::Ciphertext out_data(pool);
+    seal::Ciphertext intermediate(pool);
+    evaluator->multiply_plain(client_array[0], data[0], out_data, pool);
+    for (uint64_t i = 1; i < len; i++) {
+        // ciphertext multiply
+        evaluator->multiply_plain(client_array[i], data[i], intermediate, pool);
+        // ciphertext add
+        evaluator->add_inplace(out_data, intermediate);
+    }
+    return out_data;
+}
+
+// VectorPR: dot product of the encrypted column selector with one plaintext database row,
+// written into result using scratch for the products. Neither allocates once both have been
+// sized by an earlier call, which keeps steady-state scans free of allocations.
+inline int vector_dot_cp_into(std::vector<seal::Ciphertext>& col_select_vec, const std::vector<seal::Plaintext>& row_select_vec, size_t len, seal::Evaluator* evaluator,
+                              seal::Ciphertext& result, seal::Ciphertext& scratch, seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool()) {
+    if (len < 1) {
+        std::cout << "ERROR: Vector length should be greater than or equal to 1" << std::endl;
+        return -1;
+    }
+
+    TraceScope span("row_dot");
+    evaluator->multiply_plain(col_select_vec[0], row_select_vec[0], result, pool);
+    for (size_t j = 1; j < len; j++) {
+        evaluator->multiply_plain(col_select_vec[j], row_select_vec[j], scratch, pool);
+        evaluator->add_inplace(result, scratch);
+    }
+    return 0;
+}
+
+// VectorPR: dot product of the encrypted column selector with one plaintext database row
+inline seal::Ciphertext vector_dot_cp(std::vector<seal::Ciphertext>& col_select_vec, const std::vector<seal::Plaintext>& row_select_vec, size_t len, seal::Evaluator* evaluator, seal::Decryptor* d,
+                                      seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool()) {
+    seal::Ciphertext result(pool);
+    seal::Ciphertext temp(pool);
+    vector_dot_cp_into(col_select_vec, row_select_vec, len, evaluator, result, temp, pool);
+    // std::cout << "Out_data budget: " << d->invariant_noise_budget(result) << std::endl;
+    return result;
+}
+
+// VectorPR: dot product of the encrypted row selector with the intermediate ciphertexts, written into
+// result using scratch (size 3 capacity avoids reallocation). With relin_keys every product is
+// relinearized back to size 2 before it is added.
+inline int vector_dot_cc_into(std::vector<seal::Ciphertext>& col_select_vec, std::vector<seal::Ciphertext>& row_select_vec, size_t len, seal::Evaluator* evaluator,
+                              seal::Ciphertext& result, seal::Ciphertext& scratch, const seal::RelinKeys* relin_keys = nullptr,
+                              seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool()) {
+    if (len < 1) {
+        std::cout << "ERROR: Vector length should be greater than or equal to 1" << std::endl;
+        return -1;
+    }
+
+    TraceScope span("reduction");
+    evaluator->multiply(col_select_vec[0], row_select_vec[0], result, pool);
+    if (relin_keys) {
+        evaluator->relinearize_inplace(result, *relin_keys, pool);
+    }
+    for (size_t j = 1; j < len; j++) {
+        evaluator->multiply(col_select_vec[j], row_select_vec[j], scratch, pool);
+        if (relin_keys) {
+            evaluator->relinearize_inplace(scratch, *relin_keys, pool);
+        }
+        evaluator->add_inplace(result, scratch);
+    }
+    return 0;
+}
+
+// VectorPR: dot product of the encrypted row selector with the intermediate ciphertexts.
+// With relin_keys every product is relinearized back to size 2 before it is added.
+inline seal::Ciphertext vector_dot_cc(std::vector<seal::Ciphertext>& col_select_vec, std::vector<seal::Ciphertext>& row_select_vec, size_t len, seal::Evaluator* evaluator, seal::Decryptor* d,
+                                      const seal::RelinKeys* relin_keys = nullptr, seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool()) {
+    seal::Ciphertext result(pool);
+    seal::Ciphertext temp(pool);
+    vector_dot_cc_into(col_select_vec, row_select_vec, len, evaluator, result, temp, relin_keys, pool);
+    // std::cout << "c-c Out_data budget: " << d->invariant_noise_budget(result) << std::endl;
+    return result;
+}
+
+// VectorPR: encrypted one-hot column and row selectors for index in a vec_len x vec_len database
+inline void populate_retrieval_vectors(std::vector<seal::Ciphertext>& col_select_vec, std::vector<seal::Ciphertext>& row_select_vec, int vec_len, int index, seal::Encryptor* encryptor) {
+    seal::Ciphertext encrypted_zero;
+    seal::Ciphertext encrypted_one;
+    encryptor->encrypt_symmetric(seal::Plaintext("0"), encrypted_zero);
+    encryptor->encrypt_symmetric(seal::Plaintext("1"), encrypted_one);
+
+    // vector 1 is dotted with columns of database
+    // vector 2 is dotted with (col_select_vec * DB)
+    size_t row = index / vec_len;
+    size_t col = index % vec_len;
+
+    for (int i = 0; i < vec_len; i++) {
+        if (i == col) {
+            col_select_vec[i] = encrypted_one;
+        } else {
+            col_select_vec[i] = encrypted_zero;
+        }
+
+        if (i == row) {
+            row_select_vec[i] = encrypted_one;
+        } else {
+            row_select_vec[i] = encrypted_zero;
+        }
+    }
+}
+
+// VectorPR: full server answer for one query over a vec_len x vec_len database
+inline seal::Ciphertext vector_pr_answer(std::vector<seal::Ciphertext>& col_select_vec, std::vector<seal::Ciphertext>& row_select_vec,
+                                         const std::vector<std::vector<seal::Plaintext>>& data, size_t vec_len, seal::Evaluator* evaluator, seal::Decryptor* d) {
+    std::vector<seal::Ciphertext> intermediate_vec(vec_len);
+    for (size_t i = 0; i < vec_len; i++) {
+        intermediate_vec[i] = vector_dot_cp(col_select_vec, data[i], vec_len, evaluator, d);
+    }
+    return vector_dot_cc(row_select_vec, intermediate_vec, vec_len, evaluator, d);
+}
+
+// VectorPR answer without materializing intermediate_vec: producer threads compute each row's
+// ct x pt dot product and hand it through a bounded queue to consumer threads, which multiply it
+// by row_select_vec[i] and fold it into their own accumulator straight away. At most
+// producers + queue capacity + consumers row results are alive at once instead of vec_len, and
+// the second dimension overlaps the first. peak_rows, if given, receives that high-water mark.
+inline seal::Ciphertext vector_pr_answer_pipelined(std::vector<seal::Ciphertext>& col_select_vec, std::vector<seal::Ciphertext>& row_select_vec,
+                                                   const std::vector<std::vector<seal::Plaintext>>& data, size_t vec_len, seal::Evaluator* evaluator,
+                                                   size_t producers, size_t consumers = 1, size_t* peak_rows = nullptr) {
+    producers = std::max<size_t>(producers, 1);
+    consumers = std::max<size_t>(consumers, 1);
+    size_t capacity = producers;
+
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+    std::deque<std::pair<size_t, seal::Ciphertext>> queue;
+    size_t producers_left = producers;
+    std::atomic<size_t> next_row(0);
+    std::atomic<size_t> live(0);
+    std::atomic<size_t> peak(0);
+
+    // one pool per producer and consumer; rows cross threads, so these are thread-safe pools, just uncontended
+    auto produce = [&]() {
+        trace_thread_name("pipeline producer");
+        seal::MemoryPoolHandle pool = seal::MemoryPoolHandle::New();
+        for (size_t i = next_row++; i < vec_len; i = next_row++) {
+            size_t now = ++live;
+            for (size_t p = peak.load(); now > p && !peak.compare_exchange_weak(p, now);) {
+            }
+            seal::Ciphertext row = vector_dot_cp(col_select_vec, data[i], vec_len, evaluator, nullptr, pool);
+            TraceScope blocked("queue_full");
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [&]() { return queue.size() < capacity; });
+            queue.emplace_back(i, std::move(row));
+            not_empty.notify_one();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--producers_left == 0) {
+            not_empty.notify_all();
+        }
+    };
+
+    std::vector<seal::MemoryPoolHandle> consumer_pools;
+    std::vector<seal::Ciphertext> sums;
+    for (size_t c = 0; c < consumers; c++) {
+        consumer_pools.push_back(seal::MemoryPoolHandle::New());
+        sums.emplace_back(consumer_pools[c]);
+    }
+    std::vector<char> have(consumers, false);
+    auto consume = [&](size_t c) {
+        trace_thread_name("pipeline consumer");
+        seal::MemoryPoolHandle pool = consumer_pools[c];
+        seal::Ciphertext product(pool);
+        while (true) {
+            std::pair<size_t, seal::Ciphertext> item;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                not_empty.wait(lock, [&]() { return !queue.empty() || producers_left == 0; });
+                if (queue.empty()) {
+                    return;
+                }
+                item = std::move(queue.front());
+                queue.pop_front();
+                not_full.notify_one();
+            }
+            TraceScope fold("cc_fold", (int64_t)item.first);
+            if (have[c]) {
+                evaluator->multiply(row_select_vec[item.first], item.second, product, pool);
+                evaluator->add_inplace(sums[c], product);
+            } else {
+                evaluator->multiply(row_select_vec[item.first], item.second, sums[c], pool);
+                have[c] = true;
+            }
+            live--;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; p++) {
+        threads.emplace_back(produce);
+    }
+    for (size_t c = 0; c < consumers; c++) {
+        threads.emplace_back(consume, c);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    TraceScope span("reduction");
+    seal::Ciphertext result;
+    bool first = true;
+    for (size_t c = 0; c < consumers; c++) {
+        if (!have[c]) {
+            continue;
+        }
+        if (first) {
+            result = sums[c];
+            first = false;
+        } else {
+            evaluator->add_inplace(result, sums[c]);
+        }
+    }
+    if (peak_rows) {
+        *peak_rows = peak.load();
+    }
+    return result;
+}
+
+// packs k responses, each of whose plaintexts uses only its first `stride` coefficients, into
+// ceil(k * stride / n) ciphertexts: response i is multiplied by the monomial x^((i mod per) * stride),
+// per = n / stride, and added into packed ciphertext i / per. The multiply is a negacyclic shift of
+// each ciphertext polynomial, so it is exact and adds no noise; only the additions do.
+inline std::vector<seal::Ciphertext> pack_responses(const std::vector<seal::Ciphertext>& responses, size_t stride,
+                                                    const seal::SEALContext& context, seal::Evaluator* evaluator) {
+    std::vector<seal::Ciphertext> packed;
+    if (responses.empty()) {
+        return packed;
+    }
+    size_t n = responses[0].poly_modulus_degree();
+    size_t per = std::max<size_t>(n / std::max<size_t>(stride, 1), 1);
+    packed.resize((responses.size() + per - 1) / per);
+
+    for (size_t i = 0; i < responses.size(); i++) {
+        const seal::Ciphertext& ct = responses[i];
+        if (ct.is_ntt_form()) {
+            std::cout << "ERROR: Cannot pack NTT form responses" << std::endl;
+            packed.clear();
+            return packed;
+        }
+        size_t shift = (i % per) * stride;
+        if (shift == 0) {
+            packed[i / per] = ct;
+            continue;
+        }
+        const auto& coeff_modulus = context.get_context_data(ct.parms_id())->parms().coeff_modulus();
+        seal::Ciphertext shifted = ct;
+        for (size_t p = 0; p < ct.size(); p++) {
+            for (size_t j = 0; j < ct.coeff_modulus_size(); j++) {
+                seal::util::negacyclic_shift_poly_coeffmod(ct.data(p) + j * n, n, shift, coeff_modulus[j], shifted.data(p) + j * n);
+            }
+        }
+        evaluator->add_inplace(packed[i / per], shifted);
+    }
+    return packed;
+}
+
+// the `stride` coefficients of response i within its decrypted packed plaintext
+inline std::vector<uint64_t> unpack_response(const std::vector<seal::Plaintext>& packed, size_t i, size_t stride, size_t poly_modulus_degree) {
+    size_t per = std::max<size_t>(poly_modulus_degree / std::max<size_t>(stride, 1), 1);
+    const seal::Plaintext& plain = packed[i / per];
+    std::vector<uint64_t> coeffs(stride, 0);
+    for (size_t j = 0; j < stride; j++) {
+        // decryption trims trailing zero coefficients
+        size_t k = (i % per) * stride + j;
+        coeffs[j] = k < plain.coeff_count() ? plain[k] : 0;
+    }
+    return coeffs;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "pir_batch.h"
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+/*
+Keyword PIR: records are looked up by a 64-bit key instead of an index. Keys are cuckoo
+hashed with two hash functions into a table of buckets, each holding up to
+bucket_capacity (tag, value) records packed into the coefficients of one plaintext.
+A client derives a key's two candidate buckets locally, fetches both with ordinary index
+PIR queries (always both, so the server cannot tell which one matched), and finds the
+record whose tag matches the key.
+*/
+
+struct KeywordPIRParams {
+    size_t bucket_capacity = 4;   // records packed per bucket plaintext
+    double max_load = 0.9;        // keys / (buckets * bucket_capacity)
+    size_t max_kicks = 500;       // evictions before an insert gives up
+    uint64_t seed = 0;
+};
+
+// everything a client needs to locate and decode a key; derived from public values
+struct KeywordPIRLayout {
+    size_t bucket_count = 1;
+    size_t bucket_capacity = 4;
+    uint64_t plain_modulus = 2;
+    uint64_t seed = 0;
+
+    size_t candidate(uint64_t key, size_t h) const {
+        return pir_hash64(key ^ pir_hash64(seed + h)) % bucket_count;
+    }
+
+    // nonzero so that empty record slots (all zero) never match
+    uint64_t tag(uint64_t key) const {
+        return pir_hash64(key ^ pir_hash64(seed + 0x7461670000000000ULL)) % (plain_modulus - 1) + 1;
+    }
+
+    // coefficients 2s and 2s+1 hold slot s; the one after the last slot is always 1 so that
+    // an empty bucket never encodes to a zero plaintext
+    size_t coeff_count() const { return 2 * bucket_capacity + 1; }
+
+    // looks key up in a decrypted bucket; false if no slot carries its tag
+    bool decode(const seal::Plaintext& bucket, uint64_t key, uint64_t& value) const {
+        uint64_t key_tag = tag(key);
+        for (size_t s = 0; s < bucket_capacity && 2 * s + 1 < bucket.coeff_count(); s++) {
+            if (bucket[2 * s] == key_tag) {
+                value = bucket[2 * s + 1];
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+class KeywordPIRTable {
+public:
+    KeywordPIRTable(size_t key_count, uint64_t plain_modulus, const KeywordPIRParams& params) : params_(params), rng_(params.seed) {
+        layout_.bucket_capacity = params.bucket_capacity;
+        layout_.bucket_count = std::max<size_t>((size_t)(key_count / (params.bucket_capacity * params.max_load)) + 1, 1);
+        layout_.plain_modulus = plain_modulus;
+        layout_.seed = params.seed;
+        size_t slots = layout_.bucket_count * params.bucket_capacity;
+        keys_.resize(slots);
+        values_.resize(slots);
+        used_.resize(slots, 0);
+    }
+
+    const KeywordPIRLayout& layout() const { return layout_; }
+    size_t size() const { return size_; }
+    double load_factor() const { return (double)size_ / keys_.size(); }
+
+    // inserts or overwrites key; value must be below the plaintext modulus. Returns -1 if
+    // the random walk gives up, in which case the table should be rebuilt with a new seed.
+    int insert(uint64_t key, uint64_t value) {
+        for (size_t h = 0; h < 2; h++) {
+            size_t slot = find(layout_.candidate(key, h), key);
+            if (slot != SIZE_MAX) {
+                values_[slot] = value;
+                return 0;
+            }
+        }
+        for (size_t kick = 0; kick <= params_.max_kicks; kick++) {
+            for (size_t h = 0; h < 2; h++) {
+                size_t slot = free_slot(layout_.candidate(key, h));
+                if (slot != SIZE_MAX) {
+                    keys_[slot] = key;
+                    values_[slot] = value;
+                    used_[slot] = 1;
+                    size_++;
+                    return 0;
+                }
+            }
+            // both buckets full: swap in with a random occupant of one of them and re-place it
+            size_t bucket = layout_.candidate(key, rng_() % 2);
+            size_t slot = bucket * params_.bucket_capacity + rng_() % params_.bucket_capacity;
+            std::swap(key, keys_[slot]);
+            std::swap(value, values_[slot]);
+        }
+        // the record now left over was evicted and is lost; the table is no longer usable
+        return -1;
+    }
+
+    seal::Plaintext encode_bucket(size_t bucket) const {
+        seal::Plaintext pt(layout_.coeff_count());
+        for (size_t s = 0; s < params_.bucket_capacity; s++) {
+            size_t slot = bucket * params_.bucket_capacity + s;
+            if (used_[slot]) {
+                pt[2 * s] = layout_.tag(keys_[slot]);
+                pt[2 * s + 1] = values_[slot];
+            }
+        }
+        pt[layout_.coeff_count() - 1] = 1;
+        return pt;
+    }
+
+private:
+    size_t find(size_t bucket, uint64_t key) const {
+        for (size_t s = 0; s < params_.bucket_capacity; s++) {
+            size_t slot = bucket * params_.bucket_capacity + s;
+            if (used_[slot] && keys_[slot] == key) {
+                return slot;
+            }
+        }
+        return SIZE_MAX;
+    }
+
+    size_t free_slot(size_t bucket) const {
+        for (size_t s = 0; s < params_.bucket_capacity; s++) {
+            size_t slot = bucket * params_.bucket_capacity + s;
+            if (!used_[slot]) {
+                return slot;
+            }
+        }
+        return SIZE_MAX;
+    }
+
+    KeywordPIRParams params_;
+    KeywordPIRLayout layout_;
+    std::mt19937_64 rng_;
+    // flat arrays rather than per-bucket containers so tens of millions of keys stay compact
+    std::vector<uint64_t> keys_;
+    std::vector<uint64_t> values_;
+    std::vector<uint8_t> used_;
+    size_t size_ = 0;
+};
+
+// builds a table for keys/values, retrying with fresh seeds if cuckoo insertion fails
+inline int build_keyword_table(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& values, uint64_t plain_modulus,
+                               KeywordPIRParams params, std::unique_ptr<KeywordPIRTable>& table) {
+    for (size_t attempt = 0; attempt < 4; attempt++, params.seed = pir_hash64(params.seed)) {
+        table.reset(new KeywordPIRTable(keys.size(), plain_modulus, params));
+        size_t i = 0;
+        while (i < keys.size() && table->insert(keys[i], values[i]) == 0) {
+            i++;
+        }
+        if (i == keys.size()) {
+            return 0;
+        }
+    }
+    std::cout << "ERROR: Could not build keyword table, lower max_load or raise bucket_capacity" << std::endl;
+    table.reset();
+    return -1;
+}
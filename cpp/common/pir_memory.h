@@ -0,0 +1,129 @@
+#pragma once
+
+#include "seal/seal.h"
+#include "pir_bench.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+Memory accounting for the PIR binaries. At n = 32768 a fresh ciphertext is 2 * n * 16 primes *
+8 bytes = 8 MiB, so the query vectors and intermediate_vec, not the plaintext database, are
+what runs a large database out of memory. The structures are counted by allocated capacity,
+SEAL's pools by alloc_byte_count (everything they have taken from the system, in use or kept
+on a free list), and the process by current and peak RSS. The report goes to stdout and into
+the benchmark JSON as mem_* parameters, next to the phase timings.
+
+estimate_fits() is the check before anything large is built or mapped: it compares a planned
+footprint with MemAvailable and warns when it will not fit.
+*/
+
+inline size_t held_bytes(const seal::Plaintext& pt) { return sizeof(pt) + pt.capacity() * sizeof(uint64_t); }
+
+inline size_t held_bytes(const seal::Ciphertext& ct) {
+    return sizeof(ct) + ct.size_capacity() * ct.poly_modulus_degree() * ct.coeff_modulus_size() * sizeof(uint64_t);
+}
+
+template <typename T>
+size_t held_bytes(const std::vector<T>& v) {
+    size_t bytes = (v.capacity() - v.size()) * sizeof(T);
+    for (const auto& x : v) {
+        bytes += held_bytes(x);
+    }
+    return bytes;
+}
+
+// a size-2 ciphertext at the first data level, what every query and intermediate element is
+inline size_t fresh_ciphertext_bytes(const seal::SEALContext& context) {
+    const auto& parms = context.first_context_data()->parms();
+    return sizeof(seal::Ciphertext) + 2 * parms.poly_modulus_degree() * parms.coeff_modulus().size() * sizeof(uint64_t);
+}
+
+// a generated database entry: one coefficient, as the binaries encode it
+inline size_t generated_plaintext_bytes() { return sizeof(seal::Plaintext) + sizeof(uint64_t); }
+
+inline size_t file_bytes(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+inline size_t peak_rss_bytes() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // kilobytes on Linux
+    return (size_t)usage.ru_maxrss * 1024;
+}
+
+inline size_t current_rss_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) {
+        return 0;
+    }
+    return resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// MemAvailable, the kernel's estimate of what can be allocated without swapping; 0 if unknown
+inline size_t available_memory_bytes() {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line)) {
+        // "MemAvailable:   12345678 kB"
+        if (line.compare(0, 13, "MemAvailable:") == 0) {
+            return std::stoull(line.substr(13)) * 1024;
+        }
+    }
+    return 0;
+}
+
+inline double mib(size_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+// planned allocations by name; returns false, after a warning listing them, if they will not fit
+inline bool estimate_fits(const std::vector<std::pair<std::string, size_t>>& planned) {
+    size_t total = 0;
+    for (const auto& p : planned) {
+        total += p.second;
+    }
+    size_t available = available_memory_bytes();
+    printf("Estimated memory: %.1f MiB (available: %.1f MiB)\n", mib(total), mib(available));
+    if (available == 0 || total <= available) {
+        return true;
+    }
+    printf("WARNING: This run needs about %.0f MiB but only %.0f MiB are available; expect swapping or the OOM killer:\n",
+           mib(total), mib(available));
+    for (const auto& p : planned) {
+        printf("    %-20s %12.1f MiB\n", p.first.c_str(), mib(p.second));
+    }
+    return false;
+}
+
+class MemoryReport {
+public:
+    void add(const std::string& what, size_t bytes) { entries_.push_back({what, bytes}); }
+
+    // SEAL's global pool plus any task pools, then current and peak RSS; printed and noted in bench
+    void report(BenchHarness& bench, const std::vector<seal::MemoryPoolHandle>& pools = {}) {
+        size_t pool_bytes = seal::MemoryManager::GetPool().alloc_byte_count();
+        for (const auto& pool : pools) {
+            pool_bytes += pool.alloc_byte_count();
+        }
+        add("seal_pools", pool_bytes);
+        add("rss", current_rss_bytes());
+        add("peak_rss", peak_rss_bytes());
+
+        std::cout << "Memory:" << std::endl;
+        for (const auto& e : entries_) {
+            printf("    %-20s %12.1f MiB\n", e.first.c_str(), mib(e.second));
+            bench.note("mem_" + e.first + "_bytes", e.second);
+        }
+    }
+
+private:
+    std::vector<std::pair<std::string, size_t>> entries_;
+};
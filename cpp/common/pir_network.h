@@ -0,0 +1,80 @@
+#pragma once
+
+#include "seal/seal.h"
+#include "pir_bench.h"
+#include <cstdio>
+#include <vector>
+
+/*
+Communication accounting. A query is every selector ciphertext the client uploads (len for
+TrivialPR, 2 * vec_len for VectorPR) and a response is what it downloads. Both are measured in
+serialized form, uncompressed and with SEAL's default compression, by actually serializing
+every ciphertext: save_size() with compression is only an upper bound. The end-to-end time is
+then modeled for one round trip over a link of the given bandwidth and RTT:
+
+    client (query_gen + decrypt) + RTT + upload / bandwidth + server compute + download / bandwidth
+*/
+
+struct NetworkOptions {
+    double bandwidth_mbps = 100;    // --bandwidth-mbps B: link bandwidth in Mbit/s, both directions
+    double rtt_ms = 50;             // --rtt-ms R: round-trip time
+};
+
+struct MessageSize {
+    size_t ciphertexts = 0;
+    size_t uncompressed = 0;
+    size_t compressed = 0;
+
+    MessageSize& operator+=(const MessageSize& other) {
+        ciphertexts += other.ciphertexts;
+        uncompressed += other.uncompressed;
+        compressed += other.compressed;
+        return *this;
+    }
+};
+
+inline MessageSize message_size(const seal::Ciphertext* cts, size_t count) {
+    MessageSize size;
+    std::vector<seal::seal_byte> buffer;
+    for (size_t i = 0; i < count; i++) {
+        size.uncompressed += (size_t)cts[i].save_size(seal::compr_mode_type::none);
+        buffer.resize((size_t)cts[i].save_size(seal::Serialization::compr_mode_default));
+        size.compressed += (size_t)cts[i].save(buffer.data(), buffer.size(), seal::Serialization::compr_mode_default);
+    }
+    size.ciphertexts = count;
+    return size;
+}
+
+inline MessageSize message_size(const std::vector<seal::Ciphertext>& cts) { return message_size(cts.data(), cts.size()); }
+
+inline double transfer_seconds(size_t bytes, const NetworkOptions& net) { return bytes * 8.0 / (net.bandwidth_mbps * 1e6); }
+
+// prints the sizes and the modeled end-to-end time next to the phase timings and notes them in bench
+inline void report_communication(BenchHarness& bench, const NetworkOptions& net, const MessageSize& upload,
+                                 const MessageSize& download, double client_s, double server_s) {
+    std::cout << "Communication:" << std::endl;
+    printf("    %-10s %8zu ciphertexts %14zu bytes, compressed %14zu bytes\n", "upload", upload.ciphertexts,
+           upload.uncompressed, upload.compressed);
+    printf("    %-10s %8zu ciphertexts %14zu bytes, compressed %14zu bytes\n", "download", download.ciphertexts,
+           download.uncompressed, download.compressed);
+
+    printf("Modeled end-to-end time at %.1f Mbit/s, %.1f ms RTT (s):\n", net.bandwidth_mbps, net.rtt_ms);
+    printf("    %-14s %10s %10s %10s %10s %10s %10s\n", "", "total", "client", "RTT", "upload", "server", "download");
+    const char* names[] = {"uncompressed", "compressed"};
+    double totals[2];
+    for (int c = 0; c < 2; c++) {
+        double up = transfer_seconds(c ? upload.compressed : upload.uncompressed, net);
+        double down = transfer_seconds(c ? download.compressed : download.uncompressed, net);
+        totals[c] = client_s + net.rtt_ms * 1e-3 + up + server_s + down;
+        printf("    %-14s %10f %10f %10f %10f %10f %10f\n", names[c], totals[c], client_s, net.rtt_ms * 1e-3, up, server_s, down);
+    }
+
+    bench.note("upload_bytes", upload.uncompressed);
+    bench.note("upload_compressed_bytes", upload.compressed);
+    bench.note("download_bytes", download.uncompressed);
+    bench.note("download_compressed_bytes", download.compressed);
+    bench.note("bandwidth_mbps", net.bandwidth_mbps);
+    bench.note("rtt_ms", net.rtt_ms);
+    bench.note("modeled_e2e_s", totals[0]);
+    bench.note("modeled_e2e_compressed_s", totals[1]);
+}
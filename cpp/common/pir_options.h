@@ -0,0 +1,143 @@
+#pragma once
+
+#include "pir_bench.h"
+#include "pir_network.h"
+#include "pir_placement.h"
+#include "pir_scan_share.h"
+#include <iostream>
+#include <string>
+
+// when VectorPR relinearizes its size-3 ct x ct results; never means no relin keys are generated
+enum class RelinPolicy { never, end, per_product };
+
+// command line options shared by the PIR binaries for where the database comes from and how it is scanned
+struct DBOptions {
+    std::string save_db_path;   // --save-db PATH: write the generated database
+    bool ntt = false;           // --ntt: ... pre-transformed to NTT form
+    std::string load_db_path;   // --load-db PATH: mmap a database file instead of generating one
+    bool verify = false;        // --verify-db: check the file checksum on load
+    bool stream = false;        // --stream: read the file from disk in chunks on every query
+    bool placed = false;        // set by any of the placement options below
+    PlacementOptions placement; // --huge-pages 2m|1g, --populate, --numa partition|replicate, --threads N
+    size_t concurrent = 0;      // --concurrent K: also answer K queries at once with one shared scan
+    ScanShareOptions scan_share; // --batch-max K, --batch-window-us US
+    size_t shards = 0;          // --shards K: answer from K worker processes, one per database shard
+    size_t pipeline = 0;        // --pipeline N: fold VectorPR rows into the ct x ct accumulator on N producer threads
+    bool fused_cc = false;      // --fused-cc: also time the fused single-rescale ct x ct inner product
+    RelinPolicy relin = RelinPolicy::never; // --relin never|end|per-product
+    bool relin_compare = false; // --relin compare: measure all three policies
+    size_t request_threads = 0; // --request-threads N: answer from N threads, global pool vs warmed per-task pools
+    bool check_alloc = false;   // --check-alloc: fail unless steady-state VectorPR answers allocate nothing
+    BenchOptions bench;         // --warmup W, --trials N, --bench-json PATH, --bench-csv PATH
+    NetworkOptions network;     // --bandwidth-mbps B, --rtt-ms R: link the end-to-end time is modeled on
+};
+
+inline void print_db_usage(const char* program) {
+    std::cout << "Usage: " << program << " [--save-db PATH [--ntt]]" << std::endl;
+    std::cout << "       " << program << " --load-db PATH [--verify-db] [--stream]" << std::endl;
+    std::cout << "       " << program << " --load-db PATH [--huge-pages 2m|1g] [--populate] [--numa partition|replicate] [--threads N]" << std::endl;
+    std::cout << "       " << program << " --load-db PATH --concurrent K [--batch-max K] [--batch-window-us US]" << std::endl;
+    std::cout << "       " << program << " --shards K" << std::endl;
+    std::cout << "       " << program << " --pipeline N" << std::endl;
+    std::cout << "       " << program << " --fused-cc" << std::endl;
+    std::cout << "       " << program << " --relin never|end|per-product|compare" << std::endl;
+    std::cout << "       " << program << " --request-threads N" << std::endl;
+    std::cout << "       " << program << " --check-alloc" << std::endl;
+    std::cout << "       " << program << " [--bandwidth-mbps B] [--rtt-ms R]" << std::endl;
+    print_bench_usage(program);
+}
+
+// parses argv[i] (and its value) into opts; returns false if it is not a database option
+inline bool parse_db_option(int argc, char* argv[], int& i, DBOptions& opts) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--save-db" && has_value) {
+        opts.save_db_path = argv[++i];
+    } else if (arg == "--load-db" && has_value) {
+        opts.load_db_path = argv[++i];
+    } else if (arg == "--ntt") {
+        opts.ntt = true;
+    } else if (arg == "--verify-db") {
+        opts.verify = true;
+    } else if (arg == "--stream") {
+        opts.stream = true;
+    } else if (arg == "--huge-pages" && has_value) {
+        std::string size = argv[++i];
+        if (size != "2m" && size != "1g") {
+            return false;
+        }
+        opts.placement.huge_page_bytes = size == "1g" ? size_t(1) << 30 : size_t(2) << 20;
+        opts.placed = true;
+    } else if (arg == "--populate") {
+        opts.placement.populate = true;
+        opts.placed = true;
+    } else if (arg == "--numa" && has_value) {
+        std::string mode = argv[++i];
+        if (mode != "partition" && mode != "replicate") {
+            return false;
+        }
+        opts.placement.numa = mode == "partition" ? NumaMode::partition : NumaMode::replicate;
+        opts.placed = true;
+    } else if (arg == "--threads" && has_value) {
+        opts.placement.threads_per_node = std::stoul(argv[++i]);
+        opts.placed = true;
+    } else if (arg == "--concurrent" && has_value) {
+        opts.concurrent = std::stoul(argv[++i]);
+    } else if (arg == "--batch-max" && has_value) {
+        opts.scan_share.max_batch = std::max<size_t>(std::stoul(argv[++i]), 1);
+    } else if (arg == "--batch-window-us" && has_value) {
+        opts.scan_share.window = std::chrono::microseconds(std::stoul(argv[++i]));
+    } else if (arg == "--shards" && has_value) {
+        opts.shards = std::stoul(argv[++i]);
+    } else if (arg == "--pipeline" && has_value) {
+        opts.pipeline = std::stoul(argv[++i]);
+    } else if (arg == "--fused-cc") {
+        opts.fused_cc = true;
+    } else if (arg == "--relin" && has_value) {
+        std::string policy = argv[++i];
+        if (policy == "never") {
+            opts.relin = RelinPolicy::never;
+        } else if (policy == "end") {
+            opts.relin = RelinPolicy::end;
+        } else if (policy == "per-product") {
+            opts.relin = RelinPolicy::per_product;
+        } else if (policy == "compare") {
+            opts.relin_compare = true;
+        } else {
+            return false;
+        }
+    } else if (arg == "--request-threads" && has_value) {
+        opts.request_threads = std::stoul(argv[++i]);
+    } else if (arg == "--check-alloc") {
+        opts.check_alloc = true;
+    } else if (arg == "--bandwidth-mbps" && has_value) {
+        opts.network.bandwidth_mbps = std::stod(argv[++i]);
+    } else if (arg == "--rtt-ms" && has_value) {
+        opts.network.rtt_ms = std::stod(argv[++i]);
+    } else if (!parse_bench_option(argc, argv, i, opts.bench)) {
+        return false;
+    }
+    return true;
+}
+
+inline int parse_db_options(int argc, char* argv[], DBOptions& opts) {
+    for (int i = 1; i < argc; i++) {
+        if (!parse_db_option(argc, argv, i, opts)) {
+            print_db_usage(argv[0]);
+            return -1;
+        }
+    }
+    if ((opts.stream || opts.placed || opts.concurrent) && opts.load_db_path.empty()) {
+        std::cout << "ERROR: --stream, --concurrent and placement options need --load-db" << std::endl;
+        return -1;
+    }
+    if (opts.stream && opts.placed) {
+        std::cout << "ERROR: --stream reads the file on every query and cannot be combined with placement options" << std::endl;
+        return -1;
+    }
+    if ((opts.shards || opts.pipeline || opts.request_threads || opts.check_alloc) && !opts.load_db_path.empty()) {
+        std::cout << "ERROR: --shards, --pipeline, --request-threads and --check-alloc work on the generated database, not with --load-db" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+Hardware counters for a benchmark phase, through perf_event_open. They say whether a scan is
+compute-bound (high IPC, few LLC misses) or memory-bound (low IPC, LLC misses times the line
+size close to the machine's DRAM bandwidth). Each counter is opened on its own for this process
+with inherit set, so threads the phase spawns (the threaded scans, the pipeline producers) are
+counted too; threads that already existed when the counters were opened are not. The counters
+run from construction on, and a phase's sample is the difference of two reads: resetting an
+inherited counter does not clear what exited threads have already added to it.
+
+Counters the kernel refuses (perf_event_paranoid, no PMU in a VM, a missing cache event) are
+reported as unavailable and left out of the report rather than failing the run. Multiplexed
+counters are scaled by time enabled / time running, as perf stat does.
+*/
+
+enum PerfEvent { perf_cycles, perf_instructions, perf_llc_misses, perf_dtlb_misses, perf_event_count };
+
+inline const char* perf_event_name(int event) {
+    static const char* names[perf_event_count] = {"cycles", "instructions", "llc_misses", "dtlb_misses"};
+    return names[event];
+}
+
+// counter values for one run of a phase; a counter the kernel refused is not valid
+struct PerfSample {
+    uint64_t value[perf_event_count] = {};
+    bool valid[perf_event_count] = {};
+
+    double ipc() const {
+        return valid[perf_cycles] && valid[perf_instructions] && value[perf_cycles]
+                   ? double(value[perf_instructions]) / value[perf_cycles]
+                   : 0;
+    }
+
+    // every LLC miss fetches one line, so this is a lower bound on DRAM read traffic
+    // (hardware prefetches that hit in the LLC are not misses, writebacks are not counted)
+    double llc_miss_bytes() const { return valid[perf_llc_misses] ? value[perf_llc_misses] * 64.0 : 0; }
+};
+
+class PerfCounters {
+public:
+    PerfCounters() {
+        for (int e = 0; e < perf_event_count; e++) {
+            fds_[e] = open_counter(e);
+        }
+        if (!available()) {
+            std::cout << "WARNING: No hardware counters available (check /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+        }
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const {
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void start() { read_all(start_); }
+
+    PerfSample stop() {
+        Reading end[perf_event_count];
+        read_all(end);
+        PerfSample sample;
+        for (int e = 0; e < perf_event_count; e++) {
+            uint64_t value = end[e].value - start_[e].value;
+            uint64_t enabled = end[e].enabled - start_[e].enabled;
+            uint64_t running = end[e].running - start_[e].running;
+            if (!end[e].ok || !start_[e].ok || running == 0) {
+                continue;
+            }
+            sample.value[e] = running < enabled ? uint64_t(double(value) * enabled / running) : value;
+            sample.valid[e] = true;
+        }
+        return sample;
+    }
+
+private:
+    static int open_counter(int event) {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        switch (event) {
+        case perf_cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case perf_instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case perf_llc_misses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case perf_dtlb_misses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        }
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // this process (pid 0) on any CPU (-1), no group
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+        (void)event;
+        return -1;
+#endif
+    }
+
+    // value, time enabled, time running (PERF_FORMAT_TOTAL_TIME_*)
+    struct Reading {
+        bool ok = false;
+        uint64_t value = 0;
+        uint64_t enabled = 0;
+        uint64_t running = 0;
+    };
+
+    void read_all(Reading* readings) const {
+        for (int e = 0; e < perf_event_count; e++) {
+            readings[e] = Reading();
+#ifdef __linux__
+            uint64_t data[3];
+            if (fds_[e] >= 0 && read(fds_[e], data, sizeof(data)) == sizeof(data)) {
+                readings[e] = {true, data[0], data[1], data[2]};
+            }
+#endif
+        }
+    }
+
+    int fds_[perf_event_count];
+    Reading start_[perf_event_count];
+};
@@ -0,0 +1,307 @@
+#pragma once
+
+#include "pir_db_file.h"
+#include "pir_trace.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+// from <numaif.h>, spelled out so we don't need libnuma
+constexpr int PIR_MPOL_BIND = 2;
+constexpr unsigned PIR_MPOL_MF_MOVE = 1 << 1;
+
+enum class NumaMode { none, partition, replicate };
+
+struct PlacementOptions {
+    size_t huge_page_bytes = 0;     // 0 (regular pages, transparent huge pages requested), 2 MB or 1 GB
+    bool populate = false;          // MAP_POPULATE unbound regions so they are faulted in one batch at load
+    NumaMode numa = NumaMode::none;
+    size_t threads_per_node = 0;    // 0 uses every CPU of the node
+};
+
+struct NumaNode {
+    int id;
+    std::vector<int> cpus;
+};
+
+// online NUMA nodes and their CPUs, read from sysfs; a single node with every CPU if unavailable
+inline std::vector<NumaNode> numa_nodes() {
+    auto parse_list = [](const std::string& list) {
+        std::vector<int> out;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            size_t dash = range.find('-');
+            int lo = std::stoi(range.substr(0, dash));
+            int hi = dash == std::string::npos ? lo : std::stoi(range.substr(dash + 1));
+            for (int i = lo; i <= hi; i++) {
+                out.push_back(i);
+            }
+        }
+        return out;
+    };
+
+    std::vector<NumaNode> nodes;
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string line;
+    if (online && std::getline(online, line) && !line.empty()) {
+        for (int node : parse_list(line)) {
+            std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string cpus;
+            if (cpulist && std::getline(cpulist, cpus) && !cpus.empty()) {
+                nodes.push_back({node, parse_list(cpus)});
+            }
+        }
+    }
+    if (nodes.empty()) {
+        std::vector<int> all;
+        for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); i++) {
+            all.push_back(i);
+        }
+        nodes.push_back({-1, all});
+    }
+    return nodes;
+}
+
+inline void pin_current_thread(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/*
+Copy of a database file placed for scanning: slots live in huge-page backed anonymous
+memory and, on multi-socket hosts, are either partitioned across NUMA nodes (node k
+holds the k-th contiguous range of slots) or replicated on every node. Scans run one
+group of worker threads per node, pinned to that node's CPUs and reading only memory
+local to it.
+*/
+class PlacedPIRDatabase {
+public:
+    PlacedPIRDatabase() = default;
+    PlacedPIRDatabase(const PlacedPIRDatabase&) = delete;
+    PlacedPIRDatabase& operator=(const PlacedPIRDatabase&) = delete;
+    ~PlacedPIRDatabase() { release(); }
+
+    int load(const MappedPIRDatabase& src, const PlacementOptions& opts) {
+        release();
+        header_ = src.header();
+        opts_ = opts;
+        nodes_ = numa_nodes();
+        if (opts.numa == NumaMode::none) {
+            // one placement domain spanning the whole machine
+            std::vector<int> all;
+            for (auto& node : nodes_) {
+                all.insert(all.end(), node.cpus.begin(), node.cpus.end());
+            }
+            nodes_ = {{-1, all}};
+        }
+        size_t nodes = nodes_.size();
+        size_t total = header_.rows * header_.cols;
+        size_t slot_bytes = header_.slot_coeffs * sizeof(uint64_t);
+
+        regions_.resize(nodes);
+        for (size_t k = 0; k < nodes; k++) {
+            Region& r = regions_[k];
+            if (opts.numa == NumaMode::partition) {
+                r.first_slot = total * k / nodes;
+                r.slot_count = total * (k + 1) / nodes - r.first_slot;
+            } else {
+                r.first_slot = 0;
+                r.slot_count = total;
+            }
+            if (allocate(r, r.slot_count * slot_bytes, nodes_[k].id) != 0) {
+                release();
+                return -1;
+            }
+        }
+
+        // first touch from a thread on the owning node, so pages land there even where mbind is unavailable
+        std::vector<std::thread> copiers;
+        for (size_t k = 0; k < nodes; k++) {
+            copiers.emplace_back([&, k]() {
+                pin_current_thread(nodes_[k].cpus);
+                Region& r = regions_[k];
+                if (r.slot_count > 0) {
+                    std::memcpy(r.base, src.slot(0, 0) + r.first_slot * header_.slot_coeffs, r.slot_count * slot_bytes);
+                }
+            });
+        }
+        for (auto& t : copiers) {
+            t.join();
+        }
+        return 0;
+    }
+
+    void release() {
+        for (auto& r : regions_) {
+            if (r.base) {
+                munmap(r.base, r.mapped_bytes);
+            }
+        }
+        regions_.clear();
+    }
+
+    const PIRDBHeader& header() const { return header_; }
+    size_t rows() const { return header_.rows; }
+    size_t cols() const { return header_.cols; }
+    size_t nodes() const { return regions_.size(); }
+    const std::vector<int>& node_cpus(size_t node) const { return nodes_[node].cpus; }
+    const PlacementOptions& options() const { return opts_; }
+    bool huge_pages() const { return !regions_.empty() && regions_[0].huge; }
+
+    // range of flat slot indices whose memory lives on node
+    size_t node_first_slot(size_t node) const { return regions_[node].first_slot; }
+    size_t node_slot_count(size_t node) const { return regions_[node].slot_count; }
+
+    // slot at flat index as seen from node; replicated databases serve every node its own copy
+    const uint64_t* slot(size_t index, size_t node = 0) const {
+        if (opts_.numa == NumaMode::partition) {
+            node = 0;
+            while (index >= regions_[node].first_slot + regions_[node].slot_count) {
+                node++;
+            }
+        }
+        const Region& r = regions_[node];
+        return reinterpret_cast<const uint64_t*>(r.base) + (index - r.first_slot) * header_.slot_coeffs;
+    }
+
+private:
+    struct Region {
+        char* base = nullptr;
+        size_t mapped_bytes = 0;
+        size_t first_slot = 0;
+        size_t slot_count = 0;
+        bool huge = false;
+    };
+
+    int allocate(Region& r, size_t bytes, int node) {
+        size_t page = opts_.huge_page_bytes ? opts_.huge_page_bytes : 4096;
+        r.mapped_bytes = std::max<size_t>((bytes + page - 1) / page * page, page);
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+        // with a node binding, pages are populated after mbind by the pinned copy instead
+        if (opts_.populate && node < 0) {
+            flags |= MAP_POPULATE;
+        }
+
+        void* addr = MAP_FAILED;
+        if (opts_.huge_page_bytes) {
+            int size_flag = opts_.huge_page_bytes >= (size_t(1) << 30) ? MAP_HUGE_1GB : MAP_HUGE_2MB;
+            addr = mmap(nullptr, r.mapped_bytes, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB | size_flag, -1, 0);
+            r.huge = addr != MAP_FAILED;
+            if (!r.huge) {
+                std::cout << "WARNING: No " << (opts_.huge_page_bytes >> 20) << " MB huge pages reserved (see /proc/sys/vm/nr_hugepages), "
+                          << "falling back to transparent huge pages" << std::endl;
+            }
+        }
+        if (addr == MAP_FAILED) {
+            addr = mmap(nullptr, r.mapped_bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (addr == MAP_FAILED) {
+                std::cout << "ERROR: Could not allocate " << r.mapped_bytes << " bytes for the database" << std::endl;
+                return -1;
+            }
+            madvise(addr, r.mapped_bytes, MADV_HUGEPAGE);
+        }
+        r.base = static_cast<char*>(addr);
+
+        if (node >= 0) {
+            unsigned long mask[16] = {0};
+            mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+            if (syscall(SYS_mbind, r.base, r.mapped_bytes, PIR_MPOL_BIND, mask, sizeof(mask) * 8, PIR_MPOL_MF_MOVE) != 0) {
+                std::cout << "WARNING: mbind to node " << node << " failed, relying on first-touch placement" << std::endl;
+            }
+        }
+        return 0;
+    }
+
+    PIRDBHeader header_{};
+    PlacementOptions opts_;
+    std::vector<NumaNode> nodes_;
+    std::vector<Region> regions_;
+};
+
+// one ct x pt dot product per database row. Each node's slot range is split across that
+// node's pinned workers; rows cut by a range boundary come back as partial sums that are
+// added together at the end.
+inline std::vector<seal::Ciphertext> placed_dot_products(const PlacedPIRDatabase& db, const std::vector<seal::Ciphertext>& query,
+                                                         const seal::SEALContext& context, seal::Evaluator* evaluator) {
+    size_t cols = db.cols();
+    std::vector<seal::Ciphertext> rows(db.rows());
+    if (query.size() < cols) {
+        std::cout << "ERROR: Query shorter than database row" << std::endl;
+        rows.clear();
+        return rows;
+    }
+
+    struct Task {
+        size_t node;
+        size_t begin;
+        size_t end;
+        std::vector<std::pair<size_t, seal::Ciphertext>> partials;
+    };
+    std::vector<Task> tasks;
+    size_t nodes = db.nodes();
+    for (size_t k = 0; k < nodes; k++) {
+        size_t threads = db.options().threads_per_node ? db.options().threads_per_node : db.node_cpus(k).size();
+        size_t begin = db.node_first_slot(k);
+        size_t count = db.node_slot_count(k);
+        if (db.options().numa == NumaMode::replicate) {
+            // replicas all hold every slot; give each node an equal share of the scan
+            begin = db.rows() * cols * k / nodes;
+            count = db.rows() * cols * (k + 1) / nodes - begin;
+        }
+        for (size_t t = 0; t < threads; t++) {
+            tasks.push_back({k, begin + count * t / threads, begin + count * (t + 1) / threads, {}});
+        }
+    }
+
+    std::vector<std::thread> workers;
+    for (auto& task : tasks) {
+        workers.emplace_back([&]() {
+            pin_current_thread(db.node_cpus(task.node));
+            trace_thread_name("scan worker");
+            TraceScope span("scan_slice", (int64_t)task.node);
+            SlotAccumulator acc(context, evaluator, db.header());
+            for (size_t index = task.begin; index < task.end; index++) {
+                size_t col = index % cols;
+                acc.add(query[col], db.slot(index, task.node));
+                if (col + 1 == cols || index + 1 == task.end) {
+                    task.partials.emplace_back(index / cols, acc.finish());
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    TraceScope span("reduction");
+    std::vector<bool> have(rows.size(), false);
+    for (auto& task : tasks) {
+        for (auto& partial : task.partials) {
+            if (have[partial.first]) {
+                evaluator->add_inplace(rows[partial.first], partial.second);
+            } else {
+                rows[partial.first] = partial.second;
+                have[partial.first] = true;
+            }
+        }
+    }
+    return rows;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "seal/seal.h"
+#include <vector>
+#include <sys/resource.h>
+
+/*
+Memory pools for concurrent servers. By default every evaluator call allocates from SEAL's
+global pool, which all threads share and which serializes them on its mutex. The kernels in
+pir_kernels.h take a MemoryPoolHandle instead. Give each request task its own pool (created
+here and warmed at startup, so the first query does not pay for filling it) and the only
+allocations that contend are those of one task with itself.
+*/
+
+// one fresh, thread-safe pool per task; a result handed to another thread stays valid
+inline std::vector<seal::MemoryPoolHandle> make_task_pools(size_t count) {
+    std::vector<seal::MemoryPoolHandle> pools;
+    for (size_t i = 0; i < count; i++) {
+        pools.push_back(seal::MemoryPoolHandle::New());
+    }
+    return pools;
+}
+
+// the calling thread's own lock-free pool; only for ciphertexts that never leave the thread
+inline seal::MemoryPoolHandle thread_pool() {
+    return seal::MemoryManager::GetPool(seal::mm_prof_opt::mm_force_thread_local);
+}
+
+// fills pool with every buffer size a query's ct x pt and ct x ct steps ask for by running one
+// of each through it; SEAL pools keep freed buffers, so later queries reuse them
+inline void warm_pool(seal::MemoryPoolHandle pool, seal::Encryptor* encryptor, seal::Evaluator* evaluator) {
+    seal::Ciphertext a(pool);
+    seal::Ciphertext b(pool);
+    seal::Ciphertext product(pool);
+    seal::Ciphertext sum(pool);
+    encryptor->encrypt_symmetric(seal::Plaintext("1"), a, pool);
+    evaluator->multiply_plain(a, seal::Plaintext("1"), b, pool);
+    evaluator->multiply_plain(a, seal::Plaintext("1"), sum, pool);
+    evaluator->add_inplace(sum, b);
+    evaluator->multiply(a, sum, product, pool);
+    evaluator->multiply(a, sum, b, pool);
+    evaluator->add_inplace(product, b);
+}
+
+// context switches of this process so far; threads blocking on a contended pool mutex show up
+// as voluntary switches
+struct SwitchCounts {
+    long voluntary = 0;
+    long involuntary = 0;
+};
+
+inline SwitchCounts context_switches() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return {usage.ru_nvcsw, usage.ru_nivcsw};
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "seal/seal.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+/*
+Records larger than one plaintext coefficient. A record's bytes are packed as a little
+endian bit stream into floor(log2 t) bits per coefficient, filling up to n - 1 coefficients
+of each plaintext and spilling into further plaintexts ("planes") as needed. The last
+coefficient of every plane is fixed to 1 so no plane is ever the zero plaintext, which SEAL
+would turn into a transparent ciphertext. A database of such records is queried one plane
+at a time with the same encrypted selectors, so one query returns the whole record as
+plaintexts_per_record ciphertexts.
+*/
+struct RecordLayout {
+    size_t record_bytes;
+    size_t poly_modulus_degree;
+    size_t bits_per_coeff;
+    size_t coeffs_per_plaintext;
+    size_t plaintexts_per_record;
+
+    RecordLayout(size_t record_bytes, size_t poly_modulus_degree, uint64_t plain_modulus)
+        : record_bytes(record_bytes), poly_modulus_degree(poly_modulus_degree) {
+        bits_per_coeff = 0;
+        while (bits_per_coeff < 63 && (uint64_t(1) << (bits_per_coeff + 1)) <= plain_modulus) {
+            bits_per_coeff++;
+        }
+        coeffs_per_plaintext = poly_modulus_degree - 1;
+        size_t coeffs = (record_bytes * 8 + bits_per_coeff - 1) / bits_per_coeff;
+        plaintexts_per_record = std::max<size_t>((coeffs + coeffs_per_plaintext - 1) / coeffs_per_plaintext, 1);
+    }
+
+    // fraction of the plaintext capacity carrying record bytes
+    double packing_efficiency() const {
+        return (double)(record_bytes * 8) / (plaintexts_per_record * poly_modulus_degree * bits_per_coeff);
+    }
+};
+
+inline std::vector<seal::Plaintext> encode_record(const uint8_t* bytes, const RecordLayout& layout) {
+    std::vector<seal::Plaintext> planes(layout.plaintexts_per_record, seal::Plaintext(layout.poly_modulus_degree));
+    uint64_t mask = (uint64_t(1) << layout.bits_per_coeff) - 1;
+    // up to bits_per_coeff - 1 + 8 pending bits, which can exceed 64
+    unsigned __int128 acc = 0;
+    size_t acc_bits = 0;
+    size_t coeff = 0;
+    for (size_t i = 0; i <= layout.record_bytes; i++) {
+        // one extra pass with no input flushes the partial last coefficient
+        if (i < layout.record_bytes) {
+            acc |= (unsigned __int128)bytes[i] << acc_bits;
+            acc_bits += 8;
+        } else if (acc_bits == 0) {
+            break;
+        } else {
+            acc_bits = layout.bits_per_coeff;
+        }
+        while (acc_bits >= layout.bits_per_coeff) {
+            planes[coeff / layout.coeffs_per_plaintext][coeff % layout.coeffs_per_plaintext] = (uint64_t)acc & mask;
+            coeff++;
+            acc >>= layout.bits_per_coeff;
+            acc_bits -= layout.bits_per_coeff;
+        }
+    }
+    for (auto& plane : planes) {
+        plane[layout.poly_modulus_degree - 1] = 1;
+    }
+    return planes;
+}
+
+inline std::vector<uint8_t> decode_record(const std::vector<seal::Plaintext>& planes, const RecordLayout& layout) {
+    std::vector<uint8_t> bytes(layout.record_bytes);
+    unsigned __int128 acc = 0;
+    size_t acc_bits = 0;
+    size_t coeff = 0;
+    for (size_t i = 0; i < layout.record_bytes; i++) {
+        while (acc_bits < 8) {
+            // a decrypted plaintext drops trailing zero coefficients, so read past coeff_count as 0
+            const seal::Plaintext& plane = planes[coeff / layout.coeffs_per_plaintext];
+            size_t j = coeff % layout.coeffs_per_plaintext;
+            uint64_t value = j < plane.coeff_count() ? plane[j] : 0;
+            acc |= (unsigned __int128)value << acc_bits;
+            acc_bits += layout.bits_per_coeff;
+            coeff++;
+        }
+        bytes[i] = (uint8_t)acc;
+        acc >>= 8;
+        acc_bits -= 8;
+    }
+    return bytes;
+}
+
+// relinearizes a size-3 VectorPR response back to size 2 with relin_keys, then switches it down
+// the modulus chain as far as the remaining coefficient modulus still leaves room for the
+// plaintext, the rounding noise of the switch (~log2 n bits) and margin_bits of budget; the PIR
+// responses start with far more budget than that, so this only removes what the client does
+// not need. Returns the number of primes dropped.
+inline size_t pack_response_inplace(seal::Ciphertext& ct, const seal::SEALContext& context, seal::Evaluator* evaluator,
+                                    const seal::RelinKeys* relin_keys = nullptr, int margin_bits = 20) {
+    if (relin_keys && ct.size() > 2) {
+        evaluator->relinearize_inplace(ct, *relin_keys);
+    }
+    auto context_data = context.get_context_data(ct.parms_id());
+    int plain_bits = context_data->parms().plain_modulus().bit_count();
+    int n_bits = 0;
+    while ((size_t(1) << n_bits) < context_data->parms().poly_modulus_degree()) {
+        n_bits++;
+    }
+    size_t dropped = 0;
+    auto next = context_data->next_context_data();
+    while (next && next->total_coeff_modulus_bit_count() >= plain_bits + n_bits + margin_bits) {
+        evaluator->mod_switch_to_next_inplace(ct);
+        next = next->next_context_data();
+        dropped++;
+    }
+    return dropped;
+}
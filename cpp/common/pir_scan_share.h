@@ -0,0 +1,151 @@
+#pragma once
+
+#include "pir_db_file.h"
+#include <chrono>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+// answers every query in queries with a single pass over db; result[k][row] is query k's
+// dot product with that row. Each NTT-form slot is walked one RNS component (n words) at a
+// time and that component is multiplied against all K queries before moving on, so the
+// database is read from memory once per batch instead of once per query.
+inline std::vector<std::vector<seal::Ciphertext>> shared_dot_products(const MappedPIRDatabase& db,
+                                                                      const std::vector<const std::vector<seal::Ciphertext>*>& queries,
+                                                                      const seal::SEALContext& context, seal::Evaluator* evaluator) {
+    size_t batch = queries.size();
+    std::vector<std::vector<seal::Ciphertext>> results(batch);
+    for (auto query : queries) {
+        if (query->size() < db.cols()) {
+            std::cout << "ERROR: Query shorter than database row" << std::endl;
+            return {};
+        }
+    }
+
+    std::vector<SlotAccumulator> accs;
+    accs.reserve(batch);
+    for (size_t k = 0; k < batch; k++) {
+        accs.emplace_back(context, evaluator, db.header());
+        results[k].reserve(db.rows());
+    }
+
+    for (size_t row = 0; row < db.rows(); row++) {
+        for (size_t col = 0; col < db.cols(); col++) {
+            const uint64_t* slot = db.slot(row, col);
+            if (db.is_ntt_form()) {
+                for (size_t i = 0; i < accs[0].coeff_modulus_size(); i++) {
+                    for (size_t k = 0; k < batch; k++) {
+                        accs[k].add_component((*queries[k])[col], slot, i);
+                    }
+                }
+            } else {
+                for (size_t k = 0; k < batch; k++) {
+                    accs[k].add((*queries[k])[col], slot);
+                }
+            }
+        }
+        for (size_t k = 0; k < batch; k++) {
+            results[k].push_back(accs[k].finish());
+        }
+    }
+    return results;
+}
+
+struct ScanShareOptions {
+    size_t max_batch = 16;                        // most queries answered by one sweep
+    std::chrono::microseconds window{2000};       // longest the first query of a batch waits for others
+};
+
+/*
+Collects concurrently submitted queries and answers them together with shared_dot_products.
+A sweep starts as soon as max_batch queries are waiting or the oldest waiting query has
+waited window; a larger window trades added latency for fewer sweeps per query.
+*/
+class ScanShareScheduler {
+public:
+    ScanShareScheduler(const MappedPIRDatabase& db, const seal::SEALContext& context, seal::Evaluator* evaluator,
+                       ScanShareOptions opts = ScanShareOptions())
+        : db_(db), context_(context), evaluator_(evaluator), opts_(opts) {
+        worker_ = std::thread(&ScanShareScheduler::run, this);
+    }
+
+    ~ScanShareScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    // query must already be in the form the database expects (NTT form for NTT-form files)
+    std::future<std::vector<seal::Ciphertext>> submit(std::vector<seal::Ciphertext> query) {
+        Pending pending;
+        pending.query = std::move(query);
+        pending.arrival = std::chrono::steady_clock::now();
+        std::future<std::vector<seal::Ciphertext>> result = pending.result.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(pending));
+        }
+        cv_.notify_all();
+        return result;
+    }
+
+    size_t sweeps() const { return sweeps_; }
+    size_t queries_answered() const { return queries_answered_; }
+
+private:
+    struct Pending {
+        std::vector<seal::Ciphertext> query;
+        std::chrono::steady_clock::time_point arrival;
+        std::promise<std::vector<seal::Ciphertext>> result;
+    };
+
+    void run() {
+        while (true) {
+            std::vector<Pending> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    return;
+                }
+                auto deadline = queue_.front().arrival + opts_.window;
+                cv_.wait_until(lock, deadline, [&]() { return stop_ || queue_.size() >= opts_.max_batch; });
+                while (!queue_.empty() && batch.size() < opts_.max_batch) {
+                    batch.push_back(std::move(queue_.front()));
+                    queue_.pop_front();
+                }
+            }
+
+            std::vector<const std::vector<seal::Ciphertext>*> queries;
+            for (auto& pending : batch) {
+                queries.push_back(&pending.query);
+            }
+            std::vector<std::vector<seal::Ciphertext>> results = shared_dot_products(db_, queries, context_, evaluator_);
+            // counted before any caller can see its answer, so a caller holding all its results reads final counts
+            sweeps_++;
+            queries_answered_ += batch.size();
+            for (size_t k = 0; k < batch.size(); k++) {
+                batch[k].result.set_value(results.empty() ? std::vector<seal::Ciphertext>() : std::move(results[k]));
+            }
+        }
+    }
+
+    const MappedPIRDatabase& db_;
+    const seal::SEALContext& context_;
+    seal::Evaluator* evaluator_;
+    ScanShareOptions opts_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Pending> queue_;
+    bool stop_ = false;
+    std::atomic<size_t> sweeps_{0};
+    std::atomic<size_t> queries_answered_{0};
+    std::thread worker_;
+};
@@ -0,0 +1,283 @@
+#pragma once
+
+#include "pir_kernels.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+Sharded PIR: the database rows x cols grid is split into shards, each served by its own
+worker process over a local (AF_UNIX) stream socket. A TrivialPR database (one row) is
+split by column, and each shard returns its slice of the dot product. A VectorPR grid is
+split by row, and each shard returns sum_i row_select[i] * (col_select . data[i]) over its
+own rows. Either way the shard answers are ciphertext partial sums, so the coordinator just
+adds them together. Messages are length-prefixed serialized ciphertexts, so a TCP
+transport can be added later without changing the workers.
+*/
+
+constexpr uint64_t PIR_SHARD_STOP = 0;
+constexpr uint64_t PIR_SHARD_QUERY = 1;
+
+inline int shard_send_all(int fd, const void* buf, size_t len) {
+    const char* p = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+inline int shard_recv_all(int fd, void* buf, size_t len) {
+    char* p = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// u64 count, then per ciphertext u64 byte length and the serialized ciphertext
+inline int send_ciphertexts(int fd, const seal::Ciphertext* cts, size_t count) {
+    if (shard_send_all(fd, &count, sizeof(count)) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        std::stringstream ss;
+        cts[i].save(ss, seal::compr_mode_type::none);
+        std::string bytes = ss.str();
+        uint64_t len = bytes.size();
+        if (shard_send_all(fd, &len, sizeof(len)) != 0 || shard_send_all(fd, bytes.data(), len) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+inline int recv_ciphertexts(int fd, const seal::SEALContext& context, std::vector<seal::Ciphertext>& cts) {
+    uint64_t count;
+    if (shard_recv_all(fd, &count, sizeof(count)) != 0) {
+        return -1;
+    }
+    cts.resize(count);
+    std::string bytes;
+    for (auto& ct : cts) {
+        uint64_t len;
+        if (shard_recv_all(fd, &len, sizeof(len)) != 0) {
+            return -1;
+        }
+        bytes.resize(len);
+        if (shard_recv_all(fd, &bytes[0], len) != 0) {
+            return -1;
+        }
+        std::stringstream ss(bytes);
+        ct.load(context, ss);
+    }
+    return 0;
+}
+
+// worker loop: answers queries over its rows until told to stop or the coordinator goes away
+inline void run_shard_worker(int fd, const std::vector<std::vector<seal::Plaintext>>& rows, const seal::SEALContext& context, seal::Evaluator* evaluator) {
+    while (true) {
+        uint64_t op;
+        if (shard_recv_all(fd, &op, sizeof(op)) != 0 || op != PIR_SHARD_QUERY) {
+            return;
+        }
+        std::vector<seal::Ciphertext> col_select_vec;
+        std::vector<seal::Ciphertext> row_select_vec;
+        if (recv_ciphertexts(fd, context, col_select_vec) != 0 || recv_ciphertexts(fd, context, row_select_vec) != 0) {
+            return;
+        }
+        size_t cols = rows.empty() ? 0 : rows[0].size();
+        std::vector<seal::Ciphertext> intermediate_vec(rows.size());
+        for (size_t i = 0; i < rows.size(); i++) {
+            intermediate_vec[i] = vector_dot_cp(col_select_vec, rows[i], cols, evaluator, nullptr);
+        }
+        // without row selectors (TrivialPR) the row dot products are the answer
+        seal::Ciphertext partial = row_select_vec.empty() ? intermediate_vec[0]
+            : vector_dot_cc(row_select_vec, intermediate_vec, rows.size(), evaluator, nullptr);
+        if (send_ciphertexts(fd, &partial, 1) != 0) {
+            return;
+        }
+    }
+}
+
+class ShardCluster {
+public:
+    ShardCluster() = default;
+    ShardCluster(const ShardCluster&) = delete;
+    ShardCluster& operator=(const ShardCluster&) = delete;
+    ~ShardCluster() { stop(); }
+
+    // TrivialPR: shard s serves the s-th contiguous range of data
+    int start_trivial(const std::vector<seal::Plaintext>& data, size_t shards, const seal::SEALContext& context, seal::Evaluator* evaluator) {
+        split_ranges(data.size(), shards);
+        by_row_ = false;
+        return launch([&](size_t begin, size_t end) {
+            return std::vector<std::vector<seal::Plaintext>>{std::vector<seal::Plaintext>(data.begin() + begin, data.begin() + end)};
+        }, context, evaluator);
+    }
+
+    // VectorPR: shard s serves the s-th contiguous range of rows
+    int start_vector(const std::vector<std::vector<seal::Plaintext>>& data, size_t shards, const seal::SEALContext& context, seal::Evaluator* evaluator) {
+        split_ranges(data.size(), shards);
+        by_row_ = true;
+        return launch([&](size_t begin, size_t end) {
+            return std::vector<std::vector<seal::Plaintext>>(data.begin() + begin, data.begin() + end);
+        }, context, evaluator);
+    }
+
+    // scatters the query, gathers one partial sum per shard and adds them up
+    int answer(const std::vector<seal::Ciphertext>& col_select_vec, const std::vector<seal::Ciphertext>& row_select_vec,
+               seal::Evaluator* evaluator, seal::Ciphertext& result) {
+        std::vector<seal::Ciphertext> partials(fds_.size());
+        std::vector<int> status(fds_.size(), 0);
+        std::vector<std::thread> requests;
+        for (size_t s = 0; s < fds_.size(); s++) {
+            requests.emplace_back([&, s]() {
+                trace_thread_name("shard request");
+                TraceScope span("shard_request", (int64_t)s);
+                size_t begin = ranges_[s].first;
+                size_t end = ranges_[s].second;
+                const seal::Ciphertext* cols = by_row_ ? col_select_vec.data() : col_select_vec.data() + begin;
+                size_t col_count = by_row_ ? col_select_vec.size() : end - begin;
+                const seal::Ciphertext* rows = by_row_ ? row_select_vec.data() + begin : nullptr;
+                size_t row_count = by_row_ ? end - begin : 0;
+                std::vector<seal::Ciphertext> reply;
+                if (shard_send_all(fds_[s], &PIR_SHARD_QUERY, sizeof(PIR_SHARD_QUERY)) != 0
+                    || send_ciphertexts(fds_[s], cols, col_count) != 0
+                    || send_ciphertexts(fds_[s], rows, row_count) != 0
+                    || recv_ciphertexts(fds_[s], *context_, reply) != 0 || reply.size() != 1) {
+                    status[s] = -1;
+                    return;
+                }
+                partials[s] = reply[0];
+            });
+        }
+        for (auto& r : requests) {
+            r.join();
+        }
+        for (size_t s = 0; s < fds_.size(); s++) {
+            if (status[s] != 0) {
+                std::cout << "ERROR: Shard " << s << " did not answer" << std::endl;
+                return -1;
+            }
+        }
+        TraceScope span("reduction");
+        result = partials[0];
+        for (size_t s = 1; s < partials.size(); s++) {
+            evaluator->add_inplace(result, partials[s]);
+        }
+        return 0;
+    }
+
+    void stop() {
+        for (int fd : fds_) {
+            shard_send_all(fd, &PIR_SHARD_STOP, sizeof(PIR_SHARD_STOP));
+            close(fd);
+        }
+        for (pid_t pid : pids_) {
+            waitpid(pid, nullptr, 0);
+        }
+        fds_.clear();
+        pids_.clear();
+    }
+
+    size_t shards() const { return fds_.size(); }
+
+private:
+    void split_ranges(size_t len, size_t shards) {
+        shards = std::max<size_t>(std::min(shards, len), 1);
+        ranges_.clear();
+        for (size_t s = 0; s < shards; s++) {
+            ranges_.push_back({len * s / shards, len * (s + 1) / shards});
+        }
+    }
+
+    // make_slice(begin, end) runs in each worker after fork(), so the coordinator never holds a
+    // second copy of the database and each worker copies only its own range out of the
+    // copy-on-write pages it inherited
+    template <typename MakeSlice>
+    int launch(MakeSlice make_slice, const seal::SEALContext& context, seal::Evaluator* evaluator) {
+        stop();
+        context_ = &context;
+        for (size_t s = 0; s < ranges_.size(); s++) {
+            // listen before forking so the connect below cannot race the worker; the abstract
+            // namespace (leading NUL) leaves no socket file behind
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::string name = "pir-shard-" + std::to_string(getpid()) + "-" + std::to_string(s);
+            std::memcpy(addr.sun_path + 1, name.data(), std::min(name.size(), sizeof(addr.sun_path) - 2));
+            socklen_t addr_len = offsetof(sockaddr_un, sun_path) + 1 + name.size();
+            int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listen_fd < 0 || bind(listen_fd, (sockaddr*)&addr, addr_len) != 0 || listen(listen_fd, 1) != 0) {
+                std::cout << "ERROR: Could not open socket for shard " << s << std::endl;
+                if (listen_fd >= 0) {
+                    close(listen_fd);
+                }
+                stop();
+                return -1;
+            }
+
+            pid_t pid = fork();
+            if (pid == 0) {
+                for (int fd : fds_) {
+                    close(fd);
+                }
+                int fd = accept(listen_fd, nullptr, nullptr);
+                close(listen_fd);
+                if (fd >= 0) {
+                    run_shard_worker(fd, make_slice(ranges_[s].first, ranges_[s].second), context, evaluator);
+                    close(fd);
+                }
+                _exit(0);
+            }
+            if (pid < 0) {
+                std::cout << "ERROR: Could not start worker for shard " << s << std::endl;
+                close(listen_fd);
+                stop();
+                return -1;
+            }
+
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            close(listen_fd);
+            if (fd < 0 || connect(fd, (sockaddr*)&addr, addr_len) != 0) {
+                std::cout << "ERROR: Could not connect to shard " << s << std::endl;
+                if (fd >= 0) {
+                    close(fd);
+                }
+                // the worker is still blocked in accept() and stop() has no socket to reach it by
+                kill(pid, SIGTERM);
+                waitpid(pid, nullptr, 0);
+                stop();
+                return -1;
+            }
+            pids_.push_back(pid);
+            fds_.push_back(fd);
+        }
+        return 0;
+    }
+
+    const seal::SEALContext* context_ = nullptr;
+    bool by_row_ = false;
+    std::vector<std::pair<size_t, size_t>> ranges_;
+    std::vector<int> fds_;
+    std::vector<pid_t> pids_;
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "pir_db_file.h"
+#include <cerrno>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <numeric>
+
+// default read size; large enough that each read runs at sequential disk bandwidth
+constexpr size_t PIR_STREAM_CHUNK_BYTES = size_t(64) << 20;
+
+/*
+Streams a database file (pir_db_file.h format) from disk in large sequential chunks
+instead of keeping it resident. Two aligned buffers are used: while one chunk is being
+consumed, the next one is read into the other buffer by a background read, so disk I/O
+overlaps the ct x pt accumulation. The file is opened with O_DIRECT where the filesystem
+supports it so the scan neither fills nor evicts the page cache.
+*/
+class PIRDatabaseStream {
+public:
+    PIRDatabaseStream() = default;
+    PIRDatabaseStream(const PIRDatabaseStream&) = delete;
+    PIRDatabaseStream& operator=(const PIRDatabaseStream&) = delete;
+    ~PIRDatabaseStream() { close(); }
+
+    int open(const std::string& path, const seal::SEALContext& context, size_t chunk_bytes = PIR_STREAM_CHUNK_BYTES) {
+        close();
+        direct_io_ = true;
+        fd_ = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+        if (fd_ < 0 && errno == EINVAL) {
+            // e.g. tmpfs, which does not support O_DIRECT
+            direct_io_ = false;
+            fd_ = ::open(path.c_str(), O_RDONLY);
+        }
+        if (fd_ < 0) {
+            std::cout << "ERROR: Could not open " << path << std::endl;
+            return -1;
+        }
+        struct stat st;
+        if (fstat(fd_, &st) != 0 || (size_t)st.st_size < PIR_DB_ALIGN) {
+            std::cout << "ERROR: " << path << " is not a PIR database file" << std::endl;
+            close();
+            return -1;
+        }
+        file_len_ = st.st_size;
+
+        // O_DIRECT needs an aligned buffer even for the header page
+        if (allocate_buffers(PIR_DB_ALIGN) != 0 || pread(fd_, buffers_[0], PIR_DB_ALIGN, 0) != (ssize_t)PIR_DB_ALIGN) {
+            std::cout << "ERROR: Could not read header of " << path << std::endl;
+            close();
+            return -1;
+        }
+        std::memcpy(&header_, buffers_[0], sizeof(header_));
+        if (validate_pir_db_header(header_, file_len_, context) != 0) {
+            close();
+            return -1;
+        }
+        if (!direct_io_) {
+            posix_fadvise(fd_, header_.data_offset, header_.data_bytes, POSIX_FADV_SEQUENTIAL);
+        }
+
+        // chunks hold whole slots and stay page aligned so every read is a valid O_DIRECT read
+        size_t slot_bytes = std::max<size_t>(header_.slot_coeffs * sizeof(uint64_t), 1);
+        size_t unit = std::lcm(slot_bytes, PIR_DB_ALIGN);
+        chunk_bytes_ = std::max<size_t>(chunk_bytes / unit, 1) * unit;
+        if (allocate_buffers(chunk_bytes_) != 0) {
+            std::cout << "ERROR: Could not allocate " << 2 * chunk_bytes_ << " bytes of stream buffers" << std::endl;
+            close();
+            return -1;
+        }
+        return 0;
+    }
+
+    void close() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        fd_ = -1;
+        free_buffers();
+    }
+
+    const PIRDBHeader& header() const { return header_; }
+    size_t chunk_bytes() const { return chunk_bytes_; }
+    bool direct_io() const { return direct_io_; }
+
+    // calls consume(row, col, slot) for every slot in file order while the next chunk is
+    // read in the background; slot pointers are only valid for the duration of the call
+    int scan(const std::function<void(size_t, size_t, const uint64_t*)>& consume) {
+        size_t slot_coeffs = header_.slot_coeffs;
+        size_t slots_per_chunk = chunk_bytes_ / (slot_coeffs * sizeof(uint64_t));
+        size_t total_slots = header_.rows * header_.cols;
+        size_t chunk_count = (total_slots + slots_per_chunk - 1) / slots_per_chunk;
+
+        std::future<ssize_t> pending = std::async(std::launch::async, &PIRDatabaseStream::read_chunk, this, 0, buffers_[0]);
+        for (size_t c = 0; c < chunk_count; c++) {
+            ssize_t got = pending.get();
+            size_t first_slot = c * slots_per_chunk;
+            size_t slot_count = std::min(slots_per_chunk, total_slots - first_slot);
+            if (got < (ssize_t)(slot_count * slot_coeffs * sizeof(uint64_t))) {
+                std::cout << "ERROR: Short read while streaming database" << std::endl;
+                return -1;
+            }
+            if (c + 1 < chunk_count) {
+                pending = std::async(std::launch::async, &PIRDatabaseStream::read_chunk, this, c + 1, buffers_[(c + 1) % 2]);
+            }
+
+            const uint64_t* slots = reinterpret_cast<const uint64_t*>(buffers_[c % 2]);
+            for (size_t s = 0; s < slot_count; s++) {
+                size_t index = first_slot + s;
+                consume(index / header_.cols, index % header_.cols, slots + s * slot_coeffs);
+            }
+        }
+        return 0;
+    }
+
+private:
+    ssize_t read_chunk(size_t chunk, char* buffer) {
+        // the last chunk may run past the end of the file, which just gives a short read
+        off_t offset = header_.data_offset + chunk * chunk_bytes_;
+        size_t done = 0;
+        while (done < chunk_bytes_) {
+            ssize_t r = pread(fd_, buffer + done, chunk_bytes_ - done, offset + done);
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            if (r <= 0) {
+                break;
+            }
+            done += r;
+        }
+        return done;
+    }
+
+    int allocate_buffers(size_t bytes) {
+        free_buffers();
+        for (auto& buffer : buffers_) {
+            void* p = nullptr;
+            if (posix_memalign(&p, PIR_DB_ALIGN, bytes) != 0) {
+                return -1;
+            }
+            buffer = static_cast<char*>(p);
+        }
+        return 0;
+    }
+
+    void free_buffers() {
+        for (auto& buffer : buffers_) {
+            free(buffer);
+            buffer = nullptr;
+        }
+    }
+
+    PIRDBHeader header_{};
+    int fd_ = -1;
+    bool direct_io_ = true;
+    size_t file_len_ = 0;
+    size_t chunk_bytes_ = 0;
+    char* buffers_[2] = {nullptr, nullptr};
+};
+
+// one ct x pt dot product per database row, computed in a single streaming pass; only the
+// two stream buffers and the row currently being accumulated are ever resident
+inline std::vector<seal::Ciphertext> stream_dot_products(PIRDatabaseStream& stream, const std::vector<seal::Ciphertext>& query,
+                                                         const seal::SEALContext& context, seal::Evaluator* evaluator) {
+    const PIRDBHeader& header = stream.header();
+    std::vector<seal::Ciphertext> rows;
+    if (query.size() < header.cols) {
+        std::cout << "ERROR: Query shorter than database row" << std::endl;
+        return rows;
+    }
+
+    SlotAccumulator acc(context, evaluator, header);
+    rows.reserve(header.rows);
+    int status = stream.scan([&](size_t row, size_t col, const uint64_t* slot) {
+        acc.add(query[col], slot);
+        if (col + 1 == header.cols) {
+            rows.push_back(acc.finish());
+        }
+    });
+    if (status != 0) {
+        rows.clear();
+    }
+    return rows;
+}
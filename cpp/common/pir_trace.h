@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unistd.h>
+
+/*
+Timeline tracing in the Chrome trace event format, which Perfetto (ui.perfetto.dev) and
+chrome://tracing open directly. A TraceScope records one complete event ("ph": "X") from its
+construction to its destruction on the calling thread; benchmark phases, per-row dot products,
+reductions and per-worker tasks each get one, so idle lanes, stragglers and serial tails are
+visible per thread.
+
+Events go into a buffer owned by the recording thread: fixed-size chunks that only that thread
+appends to, published with a release store of the chunk's count, so recording never takes a
+lock or shares a cache line with another thread. A thread's buffer is registered once, on its
+first event, by a lock-free push onto a global list, and outlives the thread, so workers that
+have already exited are still in the trace. While tracing is off a TraceScope is one relaxed
+load of the enabled flag.
+*/
+
+struct TraceEvent {
+    const char* name;   // a string literal or trace_intern()ed, never freed
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    int64_t index;      // row, task or trial number, -1 for none
+};
+
+class TraceBuffer {
+public:
+    static constexpr size_t CHUNK_EVENTS = 4096;
+
+    struct Chunk {
+        TraceEvent events[CHUNK_EVENTS];
+        std::atomic<size_t> count{0};
+        std::atomic<Chunk*> next{nullptr};
+    };
+
+    TraceBuffer(uint32_t tid) : tid_(tid) { head_ = tail_ = new Chunk(); }
+
+    // owning thread only
+    void append(const TraceEvent& event) {
+        size_t n = tail_->count.load(std::memory_order_relaxed);
+        if (n == CHUNK_EVENTS) {
+            Chunk* chunk = new Chunk();
+            tail_->next.store(chunk, std::memory_order_release);
+            tail_ = chunk;
+            n = 0;
+        }
+        tail_->events[n] = event;
+        tail_->count.store(n + 1, std::memory_order_release);
+    }
+
+    // any thread; sees every event published before the call
+    template <typename F>
+    void for_each(F&& fn) const {
+        for (const Chunk* c = head_; c; c = c->next.load(std::memory_order_acquire)) {
+            size_t n = c->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < n; i++) {
+                fn(c->events[i]);
+            }
+        }
+    }
+
+    uint32_t tid() const { return tid_; }
+
+    std::atomic<const char*> thread_name{nullptr};
+    TraceBuffer* next_buffer = nullptr;
+
+private:
+    uint32_t tid_;
+    Chunk* head_;
+    Chunk* tail_;
+};
+
+class Tracer {
+public:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void enable() { enabled_.store(true, std::memory_order_relaxed); }
+
+    static uint64_t now_ns() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    TraceBuffer& local_buffer() {
+        thread_local TraceBuffer* buffer = nullptr;
+        if (!buffer) {
+            buffer = new TraceBuffer(next_tid_.fetch_add(1));
+            buffer->next_buffer = buffers_.load(std::memory_order_relaxed);
+            while (!buffers_.compare_exchange_weak(buffer->next_buffer, buffer, std::memory_order_release, std::memory_order_relaxed)) {
+            }
+        }
+        return *buffer;
+    }
+
+    // a copy of name that lives as long as the process, for names built at run time
+    const char* intern(const std::string& name) {
+        std::lock_guard<std::mutex> lock(intern_mutex_);
+        return interned_.insert(name).first->c_str();
+    }
+
+    // events recorded so far on every thread; call once the traced work has finished
+    int write(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "ERROR: Could not write " << path << std::endl;
+            return -1;
+        }
+        int pid = (int)getpid();
+        out.precision(3);
+        out << std::fixed << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+        bool first = true;
+        for (const TraceBuffer* b = buffers_.load(std::memory_order_acquire); b; b = b->next_buffer) {
+            if (const char* name = b->thread_name.load(std::memory_order_acquire)) {
+                out << (first ? "" : ",") << "\n  {\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " << pid << ", \"tid\": " << b->tid()
+                    << ", \"args\": {\"name\": \"" << name << "\"}}";
+                first = false;
+            }
+            b->for_each([&](const TraceEvent& e) {
+                // trace timestamps are microseconds
+                out << (first ? "" : ",") << "\n  {\"ph\": \"X\", \"name\": \"" << e.name << "\", \"pid\": " << pid << ", \"tid\": " << b->tid()
+                    << ", \"ts\": " << (e.begin_ns - epoch_ns_) / 1e3 << ", \"dur\": " << (e.end_ns - e.begin_ns) / 1e3;
+                if (e.index >= 0) {
+                    out << ", \"args\": {\"index\": " << e.index << "}";
+                }
+                out << "}";
+                first = false;
+            });
+        }
+        out << "\n]}\n";
+        return 0;
+    }
+
+private:
+    Tracer() : epoch_ns_(now_ns()) {}
+
+    std::atomic<bool> enabled_{false};
+    std::atomic<uint32_t> next_tid_{1};
+    std::atomic<TraceBuffer*> buffers_{nullptr};
+    uint64_t epoch_ns_;
+    std::mutex intern_mutex_;
+    std::set<std::string> interned_;
+};
+
+// records [construction, destruction) on this thread when tracing is on
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, int64_t index = -1) : name_(name), index_(index) {
+        if (Tracer::instance().enabled()) {
+            begin_ns_ = Tracer::now_ns();
+        }
+    }
+
+    ~TraceScope() {
+        if (begin_ns_) {
+            Tracer::instance().local_buffer().append({name_, begin_ns_, Tracer::now_ns(), index_});
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    int64_t index_;
+    uint64_t begin_ns_ = 0;
+};
+
+// labels the calling thread's lane in the trace; name must outlive the process (a literal or interned)
+inline void trace_thread_name(const char* name) {
+    if (Tracer::instance().enabled()) {
+        Tracer::instance().local_buffer().thread_name.store(name, std::memory_order_release);
+    }
+}
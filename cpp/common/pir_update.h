@@ -0,0 +1,143 @@
+#pragma once
+
+#include "seal/seal.h"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct PIRUpdate {
+    uint64_t index;
+    uint64_t value;     // between 1 and t - 1, like every database entry
+};
+
+/*
+In-memory rows x cols database that takes batches of (index, value) updates while it is
+being queried. Two copies of the encoded plaintexts are kept, RCU style: queries pin the
+active copy through a Snapshot, and an update batch is re-encoded (and re-NTT'd for NTT
+form databases) into the inactive copy only, which is then published. The copy just
+retired still misses the batch, so it is replayed there at the start of the next update,
+once the last query pinning it has finished. Each update touches only its own plaintext;
+nothing is rebuilt.
+*/
+class UpdatablePIRDatabase {
+    struct Buffer {
+        std::vector<std::vector<seal::Plaintext>> data;
+        std::atomic<size_t> readers{0};
+        uint64_t version = 0;
+    };
+
+public:
+    // RAII pin on one copy; the data it shows does not change while the snapshot is alive
+    class Snapshot {
+    public:
+        Snapshot(Snapshot&& other) noexcept : buffer_(other.buffer_) { other.buffer_ = nullptr; }
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        ~Snapshot() {
+            if (buffer_) {
+                buffer_->readers.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        const std::vector<std::vector<seal::Plaintext>>& data() const { return buffer_->data; }
+        uint64_t version() const { return buffer_->version; }
+
+    private:
+        friend class UpdatablePIRDatabase;
+        Buffer* buffer_;
+        explicit Snapshot(Buffer* buffer) : buffer_(buffer) {}
+    };
+
+    // data is rows x cols in coefficient form; with ntt_form both copies are kept in NTT form at parms_id
+    UpdatablePIRDatabase(const std::vector<std::vector<seal::Plaintext>>& data, uint64_t plain_modulus,
+                         bool ntt_form = false, seal::Evaluator* evaluator = nullptr, seal::parms_id_type parms_id = seal::parms_id_zero)
+        : plain_modulus_(plain_modulus), ntt_form_(ntt_form), evaluator_(evaluator), parms_id_(parms_id) {
+        rows_ = data.size();
+        cols_ = rows_ ? data[0].size() : 0;
+        for (auto& buffer : buffers_) {
+            buffer.data = data;
+            if (ntt_form_) {
+                for (auto& row : buffer.data) {
+                    for (auto& pt : row) {
+                        evaluator_->transform_to_ntt_inplace(pt, parms_id_);
+                    }
+                }
+            }
+        }
+    }
+
+    UpdatablePIRDatabase(const UpdatablePIRDatabase&) = delete;
+    UpdatablePIRDatabase& operator=(const UpdatablePIRDatabase&) = delete;
+
+    Snapshot snapshot() {
+        while (true) {
+            // pin, then re-check: sequentially consistent so a writer that retired copy i either sees
+            // the pin during its grace period or is seen here, never neither
+            int i = active_.load();
+            buffers_[i].readers.fetch_add(1);
+            if (active_.load() == i) {
+                return Snapshot(&buffers_[i]);
+            }
+            buffers_[i].readers.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // applies one batch and publishes it; returns once new snapshots see every update in it
+    int apply(const std::vector<PIRUpdate>& updates) {
+        for (const auto& u : updates) {
+            if (u.index >= rows_ * cols_) {
+                std::cout << "ERROR: Update index " << u.index << " is outside the database" << std::endl;
+                return -1;
+            }
+            // zero would encode to a zero plaintext and make the product transparent
+            if (u.value == 0 || u.value >= plain_modulus_) {
+                std::cout << "ERROR: Update value should be between 1 and plain_mod" << std::endl;
+                return -1;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        int back = 1 - active_.load(std::memory_order_relaxed);
+        Buffer& buffer = buffers_[back];
+        // grace period: wait for queries still reading the copy retired by the previous batch
+        while (buffer.readers.load() != 0) {
+            std::this_thread::yield();
+        }
+        encode(buffer, lagging_);
+        encode(buffer, updates);
+        buffer.version = buffers_[1 - back].version + 1;
+        active_.store(back);
+        lagging_ = updates;
+        return 0;
+    }
+
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    bool is_ntt_form() const { return ntt_form_; }
+
+private:
+    void encode(Buffer& buffer, const std::vector<PIRUpdate>& updates) {
+        for (const auto& u : updates) {
+            seal::Plaintext& pt = buffer.data[u.index / cols_][u.index % cols_];
+            pt = seal::Plaintext(seal::util::uint_to_hex_string(&u.value, size_t(1)));
+            if (ntt_form_) {
+                evaluator_->transform_to_ntt_inplace(pt, parms_id_);
+            }
+        }
+    }
+
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+    uint64_t plain_modulus_;
+    bool ntt_form_;
+    seal::Evaluator* evaluator_;
+    seal::parms_id_type parms_id_;
+
+    Buffer buffers_[2];
+    std::atomic<int> active_{0};
+    std::mutex writer_mutex_;
+    std::vector<PIRUpdate> lagging_;     // last published batch, not yet in the inactive copy
+};
@@ -1,4 +1,13 @@
 #include "seal/seal.h"
+#include "pir_bench.h"
+#include "pir_db_file.h"
+#include "pir_kernels.h"
+#include "pir_memory.h"
+#include "pir_options.h"
+#include "pir_pools.h"
+#include "pir_scan_share.h"
+#include "pir_shard.h"
+#include "pir_stream.h"
 #include <iostream>
 #include <time.h>
 #include <cstdlib>
@@ -6,12 +15,6 @@
 using namespace std;
 using namespace seal;
 
-// declare functions
-int client_populate(vector<Ciphertext>& client_array, size_t len, size_t index, Encryptor* encryptor);
-Ciphertext server_compute(vector<Plaintext>& data, vector<Ciphertext>& client_array, size_t len, Evaluator* evaluator, Decryptor* d);
-Ciphertext server_compute_relinearized(vector<Plaintext>& data, vector<Ciphertext>& client_array, size_t len, Evaluator* evaluator, RelinKeys relin_keys);
-Plaintext client_decrypt(Ciphertext server_val, Decryptor* decryptor);
-
 // Server data should be plaintext
 // Reduce n & q (not t) so noise budget is as small as possible after computing (1 bit of budget left)
 // Increase data elements (10,000, 20k -> 100,000) and see how it affects budget and timing
@@ -19,10 +22,15 @@ Plaintext client_decrypt(Ciphertext server_val, Decryptor* decryptor);
 // keep track of:
 // data size, n, q, budget, time
 
-int main() {
-    // instantiate timing variables
-    clock_t start;
-    clock_t t;
+int main(int argc, char* argv[]) {
+    // database file options, see print_db_usage
+    DBOptions db_opts;
+    if (parse_db_options(argc, argv, db_opts) != 0) {
+        return 1;
+    }
+
+    // every phase is timed on the wall clock, repeated as --warmup / --trials ask
+    BenchHarness bench("trivial_pr", db_opts.bench);
 
     // initialize encryption parameters
     EncryptionParameters parms(scheme_type::bfv);
@@ -47,6 +55,8 @@ int main() {
     parms.set_plain_modulus(plain_mod);
 
     SEALContext context(parms);
+    bench.note("n", poly_modulus_degree);
+    bench.note("t", plain_mod);
 
     KeyGenerator keygen(context);
     SecretKey secret_key = keygen.secret_key();
@@ -58,24 +68,77 @@ int main() {
     size_t len = 1600;//32000;
     // initialize arrays
     // use vectors instead of arrays
-    vector<Plaintext> data(len);
-    vector<Ciphertext> request(len);
+    vector<Plaintext> data;
+    MappedPIRDatabase db;
+    PlacedPIRDatabase placed_db;
 
-    cout << "Initializing server data array..." << endl;
+    if (!db_opts.load_db_path.empty()) {
+        cout << "Mapping server database file..." << endl;
 
-    // Initialize random seed
-    srand(time(0));
+        if (bench.run("db_init", [&]() { return db.open(db_opts.load_db_path, context, db_opts.verify) != 0 || db.rows() != 1 ? -1 : 0; }) != 0) {
+            cout << "ERROR: Could not load database from " << db_opts.load_db_path << endl;
+            return -1;
+        }
+        len = db.cols();
+        cout << "Size of data array: " << len << endl;
+        printf("Time to map server database file (s): %f\n", bench.median("db_init"));
+
+        // mapping reads nothing yet, but a mapped scan faults the whole file in and placement
+        // copies it; --stream keeps only its two chunk buffers resident unless --concurrent scans the mapping
+        size_t db_file_bytes = file_bytes(db_opts.load_db_path);
+        size_t ct_bytes = fresh_ciphertext_bytes(context);
+        estimate_fits({{"database", !db_opts.stream || db_opts.concurrent ? db_file_bytes : 0},
+                       {"stream buffers", db_opts.stream ? 2 * PIR_STREAM_CHUNK_BYTES : 0},
+                       {"placed copy", db_opts.placed ? db_file_bytes : 0},
+                       {"query", (1 + db_opts.concurrent) * len * ct_bytes}});
+
+        if (db_opts.placed) {
+            cout << "Placing server database in memory..." << endl;
+            // placement binds and faults in fresh memory, so it is measured once
+            PhaseTimer timer;
+            if (placed_db.load(db, db_opts.placement) != 0) {
+                return -1;
+            }
+            bench.record("db_place", timer.elapsed());
+            cout << "NUMA nodes: " << placed_db.nodes() << ", huge pages: " << (placed_db.huge_pages() ? "yes" : "no") << endl;
+            printf("Time to place server database (s): %f\n", bench.median("db_place"));
+        }
+    } else {
+        estimate_fits({{"database", len * generated_plaintext_bytes()}, {"query", len * fresh_ciphertext_bytes(context)}});
+        data.resize(len);
+
+        cout << "Initializing server data array..." << endl;
+
+        // Initialize random seed
+        srand(time(0));
+
+        bench.run("db_init", [&]() {
+            for (uint64_t i = 0; i < len; i++) {
+                // Value should be between 1 and plain_mod
+                uint64_t val = rand() % (plain_mod-1) + 1;
+                Plaintext i_plain(seal::util::uint_to_hex_string(&val, size_t(1)));
+                data[i] = i_plain;
+            }
+        });
+        cout << "Size of data array: " << len << endl;
+        printf("Time to initialize server data array (s): %f\n", bench.median("db_init"));
+
+        if (!db_opts.save_db_path.empty()) {
+            cout << "Writing server database file..." << endl;
+            if (write_pir_db(db_opts.save_db_path, context, {data}, db_opts.ntt, &evaluator, context.first_parms_id()) != 0) {
+                return -1;
+            }
+        }
+    }
 
-    start = clock();
-    for (uint64_t i = 0; i < len; i++) {
-        // Value should be between 1 and plain_mod
-        uint64_t val = rand() % (plain_mod-1) + 1;
-        Plaintext i_plain(seal::util::uint_to_hex_string(&val, size_t(1)));
-        data[i] = i_plain;
+    ShardCluster cluster;
+    if (db_opts.shards) {
+        cout << "Starting " << db_opts.shards << " shard workers..." << endl;
+        if (cluster.start_trivial(data, db_opts.shards, context, &evaluator) != 0) {
+            return -1;
+        }
     }
-    t = clock() - start;
-    cout << "Size of data array: " << len << endl;
-    printf("Time to initialize server data array (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+    vector<Ciphertext> request(len);
 
     size_t index;
     cout << "Input the index to retreive: " << endl;
@@ -83,105 +146,216 @@ int main() {
 
     cout << "Populating client retrieval array..." << endl;
 
-    start = clock();
-    client_populate(request, len, index, &encryptor);
-    t = clock() - start;
-    printf("Time to initialize client retrieval array (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+    bench.note("db_len", len);
+    bench.run("query_gen", [&]() {
+        client_populate(request, len, index, &encryptor);
+        if (db.is_ntt_form()) {
+            // pre-NTT'd databases are multiplied against the query in NTT form
+            for (auto& ct : request) {
+                evaluator.transform_to_ntt_inplace(ct);
+            }
+        }
+    });
+    printf("Time to initialize client retrieval array (s): %f\n", bench.median("query_gen"));
 
     cout << "Computing dot product..." << endl;
 
-    start = clock();
-    Ciphertext server_val = server_compute(data, request, len, &evaluator, &decryptor);
-    t = clock() - start;
-    printf("Time to compute array dot product (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+    Ciphertext server_val;
+    int status = bench.run("compute", [&]() {
+        if (db_opts.shards) {
+            // the scan runs in the worker processes, so the CPU time here is only the coordinator's
+            return cluster.answer(request, {}, &evaluator, server_val);
+        } else if (db_opts.load_db_path.empty()) {
+            server_val = server_compute(data, request, len, &evaluator, &decryptor);
+        } else if (db_opts.placed) {
+            server_val = placed_dot_products(placed_db, request, context, &evaluator)[0];
+        } else if (db_opts.stream) {
+            PIRDatabaseStream stream;
+            vector<Ciphertext> rows;
+            if (stream.open(db_opts.load_db_path, context) != 0 || (rows = stream_dot_products(stream, request, context, &evaluator)).empty()) {
+                return -1;
+            }
+            server_val = rows[0];
+        } else {
+            server_val = dot_product_mapped(request, db, 0, context, &evaluator);
+        }
+        return 0;
+    });
+    if (status != 0) {
+        return -1;
+    }
+    if (db_opts.shards) {
+        printf("Time to compute array dot product across %zu shards (s): %f\n", cluster.shards(), bench.median("compute"));
+    } else {
+        printf("Time to compute array dot product (s): %f\n", bench.median("compute"));
+    }
 
     cout << "Decrypting dot product..." << endl;
 
-    start = clock();
-    Plaintext result = client_decrypt(server_val, &decryptor);
-    t = clock() - start;
-    printf("Time to decrypt dot product (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+    Plaintext result;
+    bench.run("decrypt", [&]() { decryptor.decrypt(server_val, result); });
+    printf("Time to decrypt dot product (s): %f\n", bench.median("decrypt"));
+    cout << "    + decryption of result_encrypted: 0x" << result.to_string() << endl;
+    cout << "    + size of encrypted x after computation: " << server_val.size() << endl;
+    cout << "    + noise budget in encrypted x after computation: " << decryptor.invariant_noise_budget(server_val) << " bits"
+         << endl;
 
     // Verify correct decryption result
-    if (result != data[index]) {
+    Plaintext expected = db_opts.load_db_path.empty() ? data[index] : db.plaintext(0, index, context);
+    if (result != expected) {
         cout << "ERROR: Retrieved incorrect value" << endl;
-        cout << "Expected 0x" << data[index].to_string() << endl;
+        cout << "Expected 0x" << expected.to_string() << endl;
         cout << "Retrieved 0x" << result.to_string() << endl;
         return -1;
     }
 
     cout << "0x" << result.to_string() << endl;
 
+    cout << "Measuring serialized query and response..." << endl;
+    report_communication(bench, db_opts.network, message_size(request), message_size(&server_val, 1),
+                         bench.median("query_gen") + bench.median("decrypt"), bench.median("compute"));
+
+    if (db_opts.concurrent > 0) {
+        cout << "Answering " << db_opts.concurrent << " concurrent queries with shared scans..." << endl;
+
+        // queries for consecutive indices, submitted together as independent clients would
+        vector<vector<Ciphertext>> queries(db_opts.concurrent, vector<Ciphertext>(len));
+        for (size_t k = 0; k < db_opts.concurrent; k++) {
+            client_populate(queries[k], len, (index + k) % len, &encryptor);
+            if (db.is_ntt_form()) {
+                for (auto& ct : queries[k]) {
+                    evaluator.transform_to_ntt_inplace(ct);
+                }
+            }
+        }
 
-    // cout << "Computing relinearized dot product..." << endl;
-
-    // RelinKeys relin_keys;
-    // keygen.create_relin_keys(relin_keys);
-
-    // start = clock();
-    // Ciphertext server_val_relinearized = server_compute_relinearized(data, request, len, &evaluator, relin_keys);
-    // t = clock() - start;
-    // printf("Time to compute relinearized dot product (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
-
-    // cout << "Decrypting relinearized dot product..." << endl;
-
-    // Plaintext result_relinearized = client_decrypt(server_val_relinearized, &decryptor);
-
-    // cout << "0x" << result_relinearized.to_string() << endl;
-}
-
-// populates client array
-int client_populate(vector<Ciphertext>& client_array, size_t len, size_t index, Encryptor* encryptor) {
-    Ciphertext encrypted_zero;
-    Ciphertext encrypted_one;
-
-    encryptor->encrypt_symmetric(Plaintext("0"), encrypted_zero);
-    encryptor->encrypt_symmetric(Plaintext("1"), encrypted_one);
-
-    for (size_t i = 0; i < len; i++) {
-        client_array[i] = encrypted_zero;
-        if (i == index) {
-            client_array[i] = encrypted_one;
+        PhaseTimer timer;
+        ScanShareScheduler scheduler(db, context, &evaluator, db_opts.scan_share);
+        vector<future<vector<Ciphertext>>> answers;
+        for (auto& query : queries) {
+            answers.push_back(scheduler.submit(query));
+        }
+        vector<Ciphertext> responses;
+        for (size_t k = 0; k < answers.size(); k++) {
+            vector<Ciphertext> rows = answers[k].get();
+            if (rows.empty()) {
+                return -1;
+            }
+            Plaintext answer;
+            decryptor.decrypt(rows[0], answer);
+            if (answer != db.plaintext(0, (index + k) % len, context)) {
+                cout << "ERROR: Retrieved incorrect value for concurrent query " << k << endl;
+                return -1;
+            }
+            responses.push_back(rows[0]);
+        }
+        bench.record("compute_concurrent", timer.elapsed());
+        cout << "Database sweeps: " << scheduler.sweeps() << " for " << scheduler.queries_answered() << " queries" << endl;
+        printf("Time to answer concurrent queries (s): %f\n", bench.median("compute_concurrent"));
+        printf("Time per query (s): %f\n", bench.median("compute_concurrent")/db_opts.concurrent);
+
+        // every answer holds its value in coefficient 0, so n of them share one ciphertext
+        vector<Ciphertext> packed;
+        if (bench.run("pack", [&]() {
+                packed = pack_responses(responses, 1, context, &evaluator);
+                return packed.empty() ? -1 : 0;
+            }) != 0) {
+            return -1;
+        }
+        MessageSize unpacked_size = message_size(responses);
+        MessageSize packed_size = message_size(packed);
+        printf("Time to pack concurrent responses (s): %f\n", bench.median("pack"));
+        cout << "Concurrent response download: " << unpacked_size.ciphertexts << " -> " << packed_size.ciphertexts << " ciphertexts, "
+             << unpacked_size.uncompressed << " -> " << packed_size.uncompressed << " bytes (compressed "
+             << unpacked_size.compressed << " -> " << packed_size.compressed << ")" << endl;
+        bench.note("concurrent_download_bytes", unpacked_size.uncompressed);
+        bench.note("concurrent_packed_download_bytes", packed_size.uncompressed);
+
+        vector<Plaintext> packed_decrypted(packed.size());
+        for (size_t i = 0; i < packed.size(); i++) {
+            decryptor.decrypt(packed[i], packed_decrypted[i]);
+        }
+        for (size_t k = 0; k < responses.size(); k++) {
+            uint64_t value = unpack_response(packed_decrypted, k, 1, poly_modulus_degree)[0];
+            if (value != db.plaintext(0, (index + k) % len, context)[0]) {
+                cout << "ERROR: Retrieved incorrect packed value for concurrent query " << k << endl;
+                return -1;
+            }
         }
     }
-    return 0;
-}
 
-Ciphertext server_compute(vector<Plaintext>& data, vector<Ciphertext>& client_array, size_t len, Evaluator* evaluator, Decryptor* d) {
-    Ciphertext out_data;
-    Ciphertext intermediate;
-    evaluator->multiply_plain(client_array[0], data[0], out_data);
-    for (uint64_t i = 1; i < len; i++) {
-        // ciphertext multiply
-        evaluator->multiply_plain(client_array[i], data[i], intermediate);
-        // ciphertext add
-        evaluator->add_inplace(out_data, intermediate);
+    if (db_opts.request_threads) {
+        size_t threads = db_opts.request_threads;
+        cout << "Answering from " << threads << " request threads..." << endl;
+
+        // warmed at startup, before any query is timed
+        PhaseTimer timer;
+        vector<MemoryPoolHandle> pools = make_task_pools(threads);
+        for (auto& pool : pools) {
+            warm_pool(pool, &encryptor, &evaluator);
+        }
+        bench.record("pool_warm", timer.elapsed());
+        printf("Time to warm %zu task pools (s): %f\n", threads, bench.median("pool_warm"));
+
+        // answers are copied into buffers from the task pools, since a thread-local pool's memory
+        // must not leave its thread, and decrypted only once the timer has stopped
+        vector<Ciphertext> answers;
+        for (size_t k = 0; k < threads; k++) {
+            answers.emplace_back(pools[k]);
+        }
+        const char* modes[] = {"global pool", "per-task pools", "thread-local pools"};
+        for (int mode = 0; mode < 3; mode++) {
+            atomic<size_t> ready{0};
+            atomic<bool> go{false};
+            vector<thread> workers;
+            for (size_t k = 0; k < threads; k++) {
+                workers.emplace_back([&, k]() {
+                    MemoryPoolHandle pool = mode == 0 ? MemoryManager::GetPool() : mode == 1 ? pools[k] : thread_pool();
+                    if (mode == 2) {
+                        // a thread-local pool only exists once its thread does, so it is warmed here
+                        warm_pool(pool, &encryptor, &evaluator);
+                    }
+                    ready++;
+                    // spin rather than block, so the start adds no context switches
+                    while (!go.load()) {
+                    }
+                    Ciphertext answer = server_compute(data, request, len, &evaluator, &decryptor, pool);
+                    answers[k] = answer;
+                });
+            }
+            while (ready.load() < threads) {
+            }
+            SwitchCounts before = context_switches();
+            timer.restart();
+            go = true;
+            for (auto& w : workers) {
+                w.join();
+            }
+            double wall = timer.elapsed().wall;
+            SwitchCounts after = context_switches();
+            for (size_t k = 0; k < threads; k++) {
+                Plaintext decrypted;
+                decryptor.decrypt(answers[k], decrypted);
+                if (decrypted != data[index]) {
+                    cout << "ERROR: Retrieved incorrect value on request thread " << k << endl;
+                    return -1;
+                }
+            }
+            printf("%s: wall time (s): %f, voluntary context switches: %ld, involuntary: %ld\n", modes[mode], wall,
+                   after.voluntary - before.voluntary, after.involuntary - before.involuntary);
+        }
     }
-    return out_data;
-}
 
-Ciphertext server_compute_relinearized(vector<Plaintext>& data, vector<Ciphertext>& client_array, size_t len, Evaluator* evaluator, RelinKeys relin_keys) {
-    Ciphertext out_data;
-    Ciphertext intermediate;
-    evaluator->multiply_plain(client_array[0], data[0], out_data);
-    for (uint64_t i = 1; i < len; i++) {
-        // ciphertext multiply
-        evaluator->multiply_plain(client_array[i], data[i], intermediate);
-        // ciphertext add
-        evaluator->add_inplace(out_data, intermediate);
+    // ct x pt products never grow past size 2, so there is nothing to relinearize and no relin keys to make
+    if (db_opts.relin != RelinPolicy::never || db_opts.relin_compare) {
+        cout << "Response size " << server_val.size() << ": TrivialPR needs no relinearization, --relin has no effect" << endl;
     }
-    cout << out_data.size() << endl;
-    evaluator->relinearize_inplace(out_data, relin_keys);
-    return out_data;
-}
 
-Plaintext client_decrypt(Ciphertext server_val, Decryptor* decryptor) {
-    Plaintext result_decrypted;
-    cout << "    + decryption of result_encrypted: ";
-    decryptor->decrypt(server_val, result_decrypted);
+    MemoryReport memory;
+    memory.add("database", db_opts.load_db_path.empty() ? held_bytes(data) : db.header().data_bytes);
+    memory.add("query", held_bytes(request));
+    memory.add("response", held_bytes(server_val));
+    memory.report(bench);
 
-    cout << "    + size of encrypted x after computation: " << server_val.size() << endl;
-    cout << "    + noise budget in encrypted x after computation: " << decryptor->invariant_noise_budget(server_val) << " bits"
-         << endl;
-    return result_decrypted;
+    return bench.report() != 0 ? -1 : 0;
 }
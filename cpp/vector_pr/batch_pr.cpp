@@ -0,0 +1,181 @@
+#include "seal/seal.h"
+#include "pir_batch.h"
+#include "pir_kernels.h"
+#include <iostream>
+#include <time.h>
+#include <cmath>
+#include <set>
+
+using namespace std;
+using namespace seal;
+
+/*
+BatchPR: retrieves k records in one round using VectorPR over cuckoo-hashed buckets.
+
+The database is split into about 1.5k buckets, every record is copied into each of its 3
+candidate buckets, and the client places its k indices so that no bucket holds more than
+one of them. The client then sends one VectorPR query per bucket (a dummy query for empty
+buckets) and the server answers each bucket with vector_dot_cp and vector_dot_cc. The
+server touches about 3N slots for the whole batch, against kN for k separate retrievals.
+*/
+
+int main() {
+    cout << "BatchPR" << endl;
+
+    EncryptionParameters parms(scheme_type::bfv);
+
+    // n
+    // select from 1024, 2048, 4096, 8192, 16384, 32768
+    size_t poly_modulus_degree = 32768;
+    cout << "Polynomial Modulus (n): " << poly_modulus_degree << endl;
+    parms.set_poly_modulus_degree(poly_modulus_degree);
+
+    // q
+    cout << "Coefficient Modulus (q): [ ";
+    for (Modulus m : CoeffModulus::BFVDefault(poly_modulus_degree)) {
+        cout << m.value() << " (" << m.bit_count() << " bits)" << ", ";
+    }
+    cout << "]" << endl;
+    parms.set_coeff_modulus(CoeffModulus::BFVDefault(poly_modulus_degree));
+
+    // t
+    uint64_t plain_mod = (uint64_t) pow(2, 59);
+    cout << "Plaintext Modulus (t): " << plain_mod << endl;
+    parms.set_plain_modulus(plain_mod);
+
+    SEALContext context(parms);
+
+    KeyGenerator keygen(context);
+    SecretKey secret_key = keygen.secret_key();
+
+    Encryptor encryptor(context, secret_key);
+    Evaluator evaluator(context);
+    Decryptor decryptor(context, secret_key);
+
+    size_t db_len = 1600;
+    vector<Plaintext> data(db_len);
+
+    cout << "Initializing server data array..." << endl;
+
+    // Initialize random seed
+    srand(time(0));
+
+    for (size_t i = 0; i < db_len; i++) {
+        // Value should be between 1 and plain_mod
+        uint64_t val = rand() % (plain_mod-1) + 1;
+        data[i] = Plaintext(seal::util::uint_to_hex_string(&val, size_t(1)));
+    }
+    cout << "Size of database: " << db_len << endl;
+
+    size_t batch_size;
+    cout << "Input the number of indices to retrieve: " << endl;
+    cin >> batch_size;
+
+    if (batch_size < 1 || batch_size > db_len) {
+        cout << "ERROR: Batch size must be between 1 and the database length" << endl;
+        return 1;
+    }
+
+    // distinct random indices stand in for the client's wish list
+    set<uint64_t> wanted;
+    while (wanted.size() < batch_size) {
+        wanted.insert(rand() % db_len);
+    }
+    vector<uint64_t> indices(wanted.begin(), wanted.end());
+
+    BatchPIRParams params = batch_pir_params(batch_size, rand());
+    BatchPIRLayout layout(db_len, params);
+    cout << "Buckets: " << params.num_buckets << ", slots after replication and padding: " << layout.total_slots() << endl;
+
+    clock_t start = clock();
+    BatchPIRServer server(data, layout);
+    clock_t t = clock() - start;
+    printf("Time to build server buckets (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+    cout << "Populating client bucket queries..." << endl;
+
+    start = clock();
+    vector<int64_t> assignment;
+    if (cuckoo_assign(indices, params, assignment) != 0) {
+        return -1;
+    }
+    vector<BucketQuery> queries;
+    batch_pir_query(layout, assignment, &encryptor, queries);
+    t = clock() - start;
+    printf("Time to populate bucket queries (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+    cout << "Computing bucket responses..." << endl;
+
+    start = clock();
+    vector<Ciphertext> responses = server.answer(queries, &evaluator, &decryptor);
+    t = clock() - start;
+    float batch_comptime = ((float)t)/CLOCKS_PER_SEC;
+    printf("Time to compute batch responses (s): %f\n", batch_comptime);
+    printf("Amortized server time per record (s): %f\n", batch_comptime / batch_size);
+
+    // every bucket answer holds its record in coefficient 0, so n of them share one ciphertext
+    start = clock();
+    vector<Ciphertext> packed = pack_responses(responses, 1, context, &evaluator);
+    t = clock() - start;
+    printf("Time to pack batch responses (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+    size_t unpacked_bytes = 0;
+    size_t packed_bytes = 0;
+    for (auto& ct : responses) {
+        unpacked_bytes += ct.save_size(compr_mode_type::none);
+    }
+    for (auto& ct : packed) {
+        packed_bytes += ct.save_size(compr_mode_type::none);
+    }
+    cout << "Response ciphertexts: " << responses.size() << " -> " << packed.size()
+         << " (" << unpacked_bytes << " -> " << packed_bytes << " bytes)" << endl;
+
+    cout << "Decrypting packed responses..." << endl;
+
+    start = clock();
+    vector<Plaintext> packed_decrypted(packed.size());
+    for (size_t i = 0; i < packed.size(); i++) {
+        decryptor.decrypt(packed[i], packed_decrypted[i]);
+    }
+    size_t retrieved = 0;
+    for (size_t b = 0; b < assignment.size(); b++) {
+        if (assignment[b] < 0) {
+            continue;
+        }
+        uint64_t value = unpack_response(packed_decrypted, b, 1, poly_modulus_degree)[0];
+        if (value != data[assignment[b]][0]) {
+            cout << "ERROR: Retrieved incorrect value for index " << assignment[b] << endl;
+            cout << "Expected 0x" << data[assignment[b]].to_string() << endl;
+            cout << "Retrieved 0x" << hex << value << dec << endl;
+            return -1;
+        }
+        retrieved++;
+    }
+    t = clock() - start;
+    printf("Time to decrypt batch responses (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+    cout << "Retrieved " << retrieved << " of " << batch_size << " records" << endl;
+
+    // baseline: one full-database VectorPR retrieval, which a non-batched client repeats k times
+    size_t vec_len = (size_t) ceil(sqrt((double) db_len));
+    vector<vector<Plaintext>> square(vec_len, vector<Plaintext>(vec_len, Plaintext("1")));
+    for (size_t i = 0; i < db_len; i++) {
+        square[i / vec_len][i % vec_len] = data[i];
+    }
+    vector<Ciphertext> col_select_vec(vec_len);
+    vector<Ciphertext> row_select_vec(vec_len);
+    populate_retrieval_vectors(col_select_vec, row_select_vec, vec_len, indices[0], &encryptor);
+
+    start = clock();
+    vector<Ciphertext> intermediate_vec(vec_len);
+    for (size_t i = 0; i < vec_len; i++) {
+        intermediate_vec[i] = vector_dot_cp(col_select_vec, square[i], vec_len, &evaluator, &decryptor);
+    }
+    vector_dot_cc(row_select_vec, intermediate_vec, vec_len, &evaluator, &decryptor);
+    t = clock() - start;
+    float single_comptime = ((float)t)/CLOCKS_PER_SEC;
+    printf("Time for one full VectorPR retrieval (s): %f\n", single_comptime);
+    printf("Estimated time for %zu separate retrievals (s): %f\n", batch_size, single_comptime * batch_size);
+    printf("Batch speedup: %fx\n", single_comptime * batch_size / batch_comptime);
+
+    return 0;
+}
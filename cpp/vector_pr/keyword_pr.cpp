@@ -0,0 +1,160 @@
+#include "seal/seal.h"
+#include "pir_keyword.h"
+#include "pir_kernels.h"
+#include <iostream>
+#include <time.h>
+#include <cmath>
+
+using namespace std;
+using namespace seal;
+
+/*
+KeywordPR: looks a record up by key with VectorPR.
+
+Keys are cuckoo hashed into a table of buckets, each packing a few (tag, value) records
+into one plaintext. The client computes the key's two candidate buckets itself, retrieves
+both with VectorPR, and picks the record whose tag matches the key.
+
+    keyword_pr              build a 5000-key table and look a key up
+    keyword_pr --keys N     only build a table of N keys and time the insertion; at tens of
+                            millions of keys the VectorPR queries would not fit in memory
+*/
+
+int main(int argc, char* argv[]) {
+    cout << "KeywordPR" << endl;
+
+    size_t key_count = 5000;
+    bool build_only = false;
+    if (argc == 3 && string(argv[1]) == "--keys") {
+        key_count = stoull(argv[2]);
+        build_only = true;
+    } else if (argc != 1) {
+        cout << "Usage: " << argv[0] << " [--keys N]" << endl;
+        return 1;
+    }
+
+    EncryptionParameters parms(scheme_type::bfv);
+
+    // n
+    // select from 1024, 2048, 4096, 8192, 16384, 32768
+    size_t poly_modulus_degree = 32768;
+    cout << "Polynomial Modulus (n): " << poly_modulus_degree << endl;
+    parms.set_poly_modulus_degree(poly_modulus_degree);
+
+    // q
+    cout << "Coefficient Modulus (q): [ ";
+    for (Modulus m : CoeffModulus::BFVDefault(poly_modulus_degree)) {
+        cout << m.value() << " (" << m.bit_count() << " bits)" << ", ";
+    }
+    cout << "]" << endl;
+    parms.set_coeff_modulus(CoeffModulus::BFVDefault(poly_modulus_degree));
+
+    // t
+    uint64_t plain_mod = (uint64_t) pow(2, 59);
+    cout << "Plaintext Modulus (t): " << plain_mod << endl;
+    parms.set_plain_modulus(plain_mod);
+
+    SEALContext context(parms);
+
+    KeyGenerator keygen(context);
+    SecretKey secret_key = keygen.secret_key();
+
+    Encryptor encryptor(context, secret_key);
+    Evaluator evaluator(context);
+    Decryptor decryptor(context, secret_key);
+
+    vector<uint64_t> keys(key_count);
+    vector<uint64_t> values(key_count);
+
+    cout << "Initializing server key-value store..." << endl;
+
+    // Initialize random seed
+    srand(time(0));
+
+    for (size_t i = 0; i < key_count; i++) {
+        keys[i] = ((uint64_t) rand() << 32) ^ rand();
+        // Value should be between 1 and plain_mod
+        values[i] = rand() % (plain_mod-1) + 1;
+    }
+
+    clock_t start = clock();
+    KeywordPIRParams params;
+    params.seed = rand();
+    unique_ptr<KeywordPIRTable> table;
+    if (build_keyword_table(keys, values, plain_mod, params, table) != 0) {
+        return -1;
+    }
+    clock_t t = clock() - start;
+    const KeywordPIRLayout& layout = table->layout();
+    cout << "Keys: " << table->size() << ", buckets: " << layout.bucket_count << ", load factor: " << table->load_factor() << endl;
+    printf("Time to insert keys (s): %f (%.0f keys/s)\n", ((float)t)/CLOCKS_PER_SEC, key_count / (((double)t)/CLOCKS_PER_SEC));
+    if (build_only) {
+        return 0;
+    }
+
+    // buckets laid out as a square VectorPR database, padded with nonzero filler
+    start = clock();
+    size_t vec_len = (size_t) ceil(sqrt((double) layout.bucket_count));
+    vector<vector<Plaintext>> data(vec_len, vector<Plaintext>(vec_len, Plaintext("1")));
+    for (size_t b = 0; b < layout.bucket_count; b++) {
+        data[b / vec_len][b % vec_len] = table->encode_bucket(b);
+    }
+    t = clock() - start;
+    printf("Time to encode buckets (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+    size_t record;
+    cout << "Input the record number whose key to look up: " << endl;
+    cin >> record;
+
+    if (record >= key_count) {
+        cout << "ERROR: Record number cannot be greater than the number of keys" << endl;
+        return 1;
+    }
+
+    // the wanted key, then a key that is not in the table
+    vector<uint64_t> lookups = {keys[record], keys[record] ^ 0x5a5a5a5a5a5a5a5aULL};
+    for (uint64_t key : lookups) {
+        cout << "Looking up key 0x" << hex << key << dec << "..." << endl;
+
+        start = clock();
+        vector<vector<Ciphertext>> col_select_vecs(2, vector<Ciphertext>(vec_len));
+        vector<vector<Ciphertext>> row_select_vecs(2, vector<Ciphertext>(vec_len));
+        for (size_t h = 0; h < 2; h++) {
+            populate_retrieval_vectors(col_select_vecs[h], row_select_vecs[h], vec_len, layout.candidate(key, h), &encryptor);
+        }
+        t = clock() - start;
+        printf("Time to populate candidate bucket queries (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+        start = clock();
+        vector<Ciphertext> responses(2);
+        for (size_t h = 0; h < 2; h++) {
+            responses[h] = vector_pr_answer(col_select_vecs[h], row_select_vecs[h], data, vec_len, &evaluator, &decryptor);
+        }
+        t = clock() - start;
+        printf("Time to compute candidate bucket responses (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+        start = clock();
+        bool found = false;
+        uint64_t value = 0;
+        for (size_t h = 0; h < 2 && !found; h++) {
+            Plaintext bucket;
+            decryptor.decrypt(responses[h], bucket);
+            found = layout.decode(bucket, key, value);
+        }
+        t = clock() - start;
+        printf("Time to decrypt and match buckets (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+        bool present = key == keys[record];
+        if (found != present || (found && value != values[record])) {
+            cout << "ERROR: Retrieved incorrect result for key" << endl;
+            return -1;
+        }
+        if (found) {
+            cout << "    value: 0x" << hex << value << dec << endl;
+        } else {
+            cout << "    not found" << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include "seal/seal.h"
+#include "pir_bench.h"
+#include "pir_kernels.h"
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace seal;
+
+/*
+SEAL half of the SEAL vs fhe.rs comparison (scripts/crosslib_compare.py). It takes the same
+options as the Rust binaries (rust/trivial_pr, rust/vector_pr), builds the same database from
+the shared splitmix64 seed, and times the same four phases: db_init, query_gen, compute and
+decrypt. It writes the BenchHarness JSON schema, which the Rust binaries write as well. The
+coefficient moduli actually used are recorded in the report, so the driver can hand the exact
+primes to fhe.rs when they were chosen here from bit sizes.
+*/
+
+struct CrossLibOptions {
+    string variant = "trivial";             // trivial | vector
+    size_t n = 2048;
+    uint64_t t = 1 << 10;
+    vector<uint64_t> moduli = {0x3fffffff000001};   // the Rust binaries' default
+    vector<int> moduli_bits;                // --moduli-bits: let SEAL pick primes of these sizes instead
+    size_t len = 100;
+    uint64_t seed = 1;
+    size_t index = 0;
+    BenchOptions bench;
+};
+
+void print_crosslib_usage(const char* program) {
+    cout << "Usage: " << program << " [--variant trivial|vector] [--n N] [--t T] [--moduli Q,...|--moduli-bits B,...]" << endl;
+    cout << "       " << program << " [--len L] [--seed S] [--index I]" << endl;
+    print_bench_usage(program);
+}
+
+int parse_crosslib_options(int argc, char* argv[], CrossLibOptions& opts) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--variant" && has_value) {
+            opts.variant = argv[++i];
+        } else if (arg == "--n" && has_value) {
+            opts.n = stoul(argv[++i]);
+        } else if (arg == "--t" && has_value) {
+            opts.t = stoull(argv[++i]);
+        } else if ((arg == "--moduli" || arg == "--moduli-bits") && has_value) {
+            stringstream ss(argv[++i]);
+            string part;
+            opts.moduli.clear();
+            opts.moduli_bits.clear();
+            while (getline(ss, part, ',')) {
+                if (arg == "--moduli") {
+                    opts.moduli.push_back(stoull(part, nullptr, 0));
+                } else {
+                    opts.moduli_bits.push_back(stoi(part));
+                }
+            }
+        } else if (arg == "--len" && has_value) {
+            opts.len = stoul(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            opts.seed = stoull(argv[++i]);
+        } else if (arg == "--index" && has_value) {
+            opts.index = stoul(argv[++i]);
+        } else if (!parse_bench_option(argc, argv, i, opts.bench)) {
+            print_crosslib_usage(argv[0]);
+            return -1;
+        }
+    }
+    if (opts.variant != "trivial" && opts.variant != "vector") {
+        print_crosslib_usage(argv[0]);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    CrossLibOptions opts;
+    if (parse_crosslib_options(argc, argv, opts) != 0) {
+        return 1;
+    }
+
+    EncryptionParameters parms(scheme_type::bfv);
+    parms.set_poly_modulus_degree(opts.n);
+    vector<Modulus> coeff_modulus;
+    if (!opts.moduli_bits.empty()) {
+        coeff_modulus = CoeffModulus::Create(opts.n, opts.moduli_bits);
+    } else {
+        for (uint64_t q : opts.moduli) {
+            coeff_modulus.push_back(Modulus(q));
+        }
+    }
+    parms.set_coeff_modulus(coeff_modulus);
+    parms.set_plain_modulus(opts.t);
+    SEALContext context(parms);
+    if (!context.parameters_set()) {
+        cout << "ERROR: Invalid encryption parameters: " << context.parameter_error_message() << endl;
+        return 1;
+    }
+
+    bool vector_variant = opts.variant == "vector";
+    size_t rows, cols;
+    if (!shared_db_shape(opts.len, vector_variant, rows, cols)) {
+        cout << "Error: Database length must be a square" << endl;
+        return 1;
+    }
+    size_t vec_len = rows;
+    if (opts.index >= opts.len) {
+        cout << "ERROR: Index cannot be greater than datase length" << endl;
+        return 1;
+    }
+
+    string moduli;
+    for (const auto& q : coeff_modulus) {
+        moduli += (moduli.empty() ? "" : ",") + to_string(q.value());
+    }
+    BenchHarness bench("pir_crosslib", opts.bench);
+    bench.note("library", "seal");
+    bench.note("variant", opts.variant);
+    bench.note("n", opts.n);
+    bench.note("t", opts.t);
+    bench.note("moduli", moduli);
+    bench.note("len", opts.len);
+    bench.note("seed", opts.seed);
+    bench.note("index", opts.index);
+
+    KeyGenerator keygen(context);
+    SecretKey secret_key = keygen.secret_key();
+    Encryptor encryptor(context, secret_key);
+    Evaluator evaluator(context);
+    Decryptor decryptor(context, secret_key);
+
+    vector<uint64_t> values = shared_db_values(opts.seed, opts.len, opts.t);
+    vector<vector<Plaintext>> data;
+    bench.run("db_init", [&]() { data = shared_db_plaintexts(values, rows, cols); });
+
+    vector<Ciphertext> col_select_vec(cols);
+    vector<Ciphertext> row_select_vec(vector_variant ? vec_len : 0);
+    bench.run("query_gen", [&]() {
+        if (vector_variant) {
+            populate_retrieval_vectors(col_select_vec, row_select_vec, vec_len, opts.index, &encryptor);
+        } else {
+            client_populate(col_select_vec, cols, opts.index, &encryptor);
+        }
+    });
+
+    Ciphertext response;
+    bench.run("compute", [&]() {
+        if (vector_variant) {
+            response = vector_pr_answer(col_select_vec, row_select_vec, data, vec_len, &evaluator, &decryptor);
+        } else {
+            response = server_compute(data[0], col_select_vec, cols, &evaluator, &decryptor);
+        }
+    });
+
+    Plaintext decrypted;
+    bench.run("decrypt", [&]() { decryptor.decrypt(response, decrypted); });
+
+    size_t query_bytes = 0;
+    for (const auto& ct : col_select_vec) {
+        query_bytes += ct.save_size(compr_mode_type::none);
+    }
+    for (const auto& ct : row_select_vec) {
+        query_bytes += ct.save_size(compr_mode_type::none);
+    }
+    bool correct = decrypted == data[opts.index / cols][opts.index % cols];
+    bench.note("query_bytes", query_bytes);
+    bench.note("response_bytes", (size_t)response.save_size(compr_mode_type::none));
+    bench.note("noise_budget", decryptor.invariant_noise_budget(response));
+    bench.note("correct", correct ? 1 : 0);
+
+    if (!correct) {
+        cout << "ERROR: Retrieved incorrect value" << endl;
+    }
+    if (bench.report() != 0 || !correct) {
+        return 1;
+    }
+    return 0;
+}
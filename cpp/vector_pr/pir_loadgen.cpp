@@ -0,0 +1,480 @@
+#include "seal/seal.h"
+#include "pir_bench.h"
+#include "pir_kernels.h"
+#include "pir_pools.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace seal;
+
+/*
+Load generator for an in-process PIR server. The server answers from a fixed pool of worker
+threads, each with its own warmed memory pool and scratch ciphertexts, so a steady-state answer
+allocates nothing and workers only meet at the request queue. Simulated clients drive it in two
+modes:
+
+- closed loop: N clients each submit a query, wait for the answer and submit the next, so the
+  offered load adapts to the server. The highest QPS over the client counts is the saturation
+  throughput.
+- open loop: queries arrive as a Poisson process at a fixed rate whatever the server does.
+  Latency is measured from each query's scheduled arrival, not from when it was handed over,
+  so a backed-up server shows up in the tail instead of being hidden (coordinated omission).
+
+Queries are encrypted before any load is applied: a few distinct indices, checked once against
+the database, then reused round-robin, so clients never spend time on encryption.
+
+    pir_loadgen --variant vector --n 4096 --db-len 1600 --server-threads 8 --clients 1,2,4,8,16 \
+                --rates 20,40,60 --duration 10 --out loadgen.csv
+*/
+
+struct LoadOptions {
+    string variant = "vector";
+    size_t n = 4096;
+    uint64_t t = 65537;
+    size_t db_len = 1600;
+    size_t server_threads = max(1u, thread::hardware_concurrency());
+    vector<size_t> clients = {1, 2, 4, 8, 16};  // closed-loop concurrency levels
+    vector<double> rates;                       // open-loop QPS; default fractions of saturation
+    double duration_s = 10;                     // measured time per configuration
+    double warmup_s = 1;                        // load applied, latencies discarded
+    size_t distinct_queries = 16;
+    uint64_t seed = 1;
+    string out_path = "loadgen.csv";
+};
+
+void print_loadgen_usage(const char* program) {
+    cout << "Usage: " << program << " [--variant trivial|vector] [--n N] [--t T] [--db-len L] [--server-threads W]" << endl;
+    cout << "       " << program << " [--clients N,...] [--rates QPS,...] [--duration S] [--warmup S]" << endl;
+    cout << "       " << program << " [--distinct-queries K] [--seed S] [--out PATH]" << endl;
+}
+
+int parse_loadgen_options(int argc, char* argv[], LoadOptions& opts) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--variant" && has_value) {
+            opts.variant = argv[++i];
+            if (opts.variant != "trivial" && opts.variant != "vector") {
+                print_loadgen_usage(argv[0]);
+                return -1;
+            }
+        } else if (arg == "--n" && has_value) {
+            opts.n = stoull(argv[++i]);
+        } else if (arg == "--t" && has_value) {
+            opts.t = stoull(argv[++i]);
+        } else if (arg == "--db-len" && has_value) {
+            opts.db_len = stoull(argv[++i]);
+        } else if (arg == "--server-threads" && has_value) {
+            opts.server_threads = max<size_t>(stoull(argv[++i]), 1);
+        } else if (arg == "--clients" && has_value) {
+            opts.clients.clear();
+            for (const auto& c : split(argv[++i], ',')) {
+                opts.clients.push_back(max<size_t>(stoull(c), 1));
+            }
+        } else if (arg == "--rates" && has_value) {
+            opts.rates.clear();
+            for (const auto& r : split(argv[++i], ',')) {
+                opts.rates.push_back(stod(r));
+            }
+        } else if (arg == "--duration" && has_value) {
+            opts.duration_s = stod(argv[++i]);
+        } else if (arg == "--warmup" && has_value) {
+            opts.warmup_s = stod(argv[++i]);
+        } else if (arg == "--distinct-queries" && has_value) {
+            opts.distinct_queries = max<size_t>(stoull(argv[++i]), 1);
+        } else if (arg == "--seed" && has_value) {
+            opts.seed = stoull(argv[++i]);
+        } else if (arg == "--out" && has_value) {
+            opts.out_path = argv[++i];
+        } else {
+            print_loadgen_usage(argv[0]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+using Clock = chrono::steady_clock;
+
+// a closed-loop client's wait for its answer. The worker signals under the lock, so the client
+// cannot return and destroy it while the worker still touches it.
+struct Completion {
+    mutex m;
+    condition_variable cv;
+    bool done = false;
+
+    void signal() {
+        lock_guard<mutex> lock(m);
+        done = true;
+        cv.notify_one();
+    }
+
+    void wait() {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [&]() { return done; });
+        done = false;
+    }
+};
+
+// one encrypted query; for TrivialPR row_select_vec is empty
+struct PIRQuery {
+    size_t index;
+    vector<Ciphertext> col_select_vec;
+    vector<Ciphertext> row_select_vec;
+};
+
+/*
+The server: W workers take requests off one queue and answer them. Each worker keeps the
+latencies of the requests it finished, started at or after the measurement start, in its own
+vector; they are read only once the server is idle.
+*/
+class PIRServer {
+public:
+    PIRServer(const LoadOptions& opts, Evaluator* evaluator, Encryptor* encryptor,
+              vector<vector<Plaintext>>& data, vector<PIRQuery>& queries)
+        : opts_(opts), evaluator_(evaluator), data_(data), queries_(queries),
+          pools_(make_task_pools(opts.server_threads)), latencies_(opts.server_threads) {
+        for (auto& pool : pools_) {
+            warm_pool(pool, encryptor, evaluator);
+        }
+        for (size_t w = 0; w < opts.server_threads; w++) {
+            workers_.emplace_back(&PIRServer::run, this, w);
+        }
+    }
+
+    ~PIRServer() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stop_ = true;
+        }
+        work_.notify_all();
+        for (auto& w : workers_) {
+            w.join();
+        }
+    }
+
+    // start is when the request counts as issued: submission for closed loop, the scheduled arrival for open loop
+    void submit(size_t query, Clock::time_point start, Completion* done = nullptr) {
+        {
+            lock_guard<mutex> lock(mutex_);
+            queue_.push_back({query, start, done});
+            outstanding_++;
+        }
+        work_.notify_one();
+    }
+
+    void wait_idle() {
+        unique_lock<mutex> lock(mutex_);
+        idle_.wait(lock, [&]() { return outstanding_ == 0; });
+    }
+
+    // latencies are kept only for requests started at or after measure_from; call while idle
+    void reset(Clock::time_point measure_from) {
+        lock_guard<mutex> lock(mutex_);
+        measure_from_ = measure_from;
+        for (auto& l : latencies_) {
+            l.clear();
+        }
+    }
+
+    // seconds, all workers; call while idle
+    vector<double> latencies() {
+        lock_guard<mutex> lock(mutex_);
+        vector<double> all;
+        for (const auto& l : latencies_) {
+            all.insert(all.end(), l.begin(), l.end());
+        }
+        return all;
+    }
+
+private:
+    struct Request {
+        size_t query;
+        Clock::time_point start;
+        Completion* done;
+    };
+
+    void run(size_t w) {
+        MemoryPoolHandle pool = pools_[w];
+        // reused for every answer, so the steady state allocates nothing
+        vector<Ciphertext> intermediate;
+        for (size_t i = 0; i < data_.size(); i++) {
+            intermediate.emplace_back(pool);
+        }
+        Ciphertext scratch(pool);
+        Ciphertext response(pool);
+
+        while (true) {
+            Request request;
+            Clock::time_point measure_from;
+            {
+                unique_lock<mutex> lock(mutex_);
+                work_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    return;
+                }
+                request = queue_.front();
+                queue_.pop_front();
+                measure_from = measure_from_;
+            }
+
+            PIRQuery& q = queries_[request.query];
+            if (opts_.variant == "vector") {
+                size_t vec_len = data_.size();
+                for (size_t i = 0; i < vec_len; i++) {
+                    vector_dot_cp_into(q.col_select_vec, data_[i], vec_len, evaluator_, intermediate[i], scratch, pool);
+                }
+                vector_dot_cc_into(q.row_select_vec, intermediate, vec_len, evaluator_, response, scratch, nullptr, pool);
+            } else {
+                vector_dot_cp_into(q.col_select_vec, data_[0], data_[0].size(), evaluator_, response, scratch, pool);
+            }
+
+            Clock::time_point end = Clock::now();
+            if (request.start >= measure_from) {
+                latencies_[w].push_back(chrono::duration<double>(end - request.start).count());
+            }
+            if (request.done) {
+                request.done->signal();
+            }
+            {
+                lock_guard<mutex> lock(mutex_);
+                if (--outstanding_ == 0) {
+                    idle_.notify_all();
+                }
+            }
+        }
+    }
+
+    const LoadOptions& opts_;
+    Evaluator* evaluator_;
+    vector<vector<Plaintext>>& data_;
+    vector<PIRQuery>& queries_;
+    vector<MemoryPoolHandle> pools_;
+    vector<vector<double>> latencies_;
+
+    mutex mutex_;
+    condition_variable work_;
+    condition_variable idle_;
+    deque<Request> queue_;
+    size_t outstanding_ = 0;
+    bool stop_ = false;
+    Clock::time_point measure_from_;
+    vector<thread> workers_;
+};
+
+struct LoadResult {
+    string mode;
+    size_t clients = 0;
+    double target_qps = 0;
+    size_t completed = 0;
+    double elapsed_s = 0;
+    double qps = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+    double mean = 0;
+};
+
+// nearest rank, like sample_stats, with the p99.9 it does not report
+LoadResult summarize(const string& mode, size_t clients, double target_qps, vector<double> latencies, double elapsed_s) {
+    LoadResult r;
+    r.mode = mode;
+    r.clients = clients;
+    r.target_qps = target_qps;
+    r.completed = latencies.size();
+    r.elapsed_s = elapsed_s;
+    r.qps = elapsed_s > 0 ? latencies.size() / elapsed_s : 0;
+    if (latencies.empty()) {
+        return r;
+    }
+    sort(latencies.begin(), latencies.end());
+    auto rank = [&](double p) {
+        size_t k = (size_t)ceil(p * latencies.size());
+        return latencies[min(max<size_t>(k, 1), latencies.size()) - 1];
+    };
+    SampleStats stats = sample_stats(latencies);
+    r.p50 = stats.median;
+    r.p99 = stats.p99;
+    r.p999 = rank(0.999);
+    r.max = latencies.back();
+    r.mean = stats.mean;
+    return r;
+}
+
+// N clients, each with one request in flight, for warmup + duration
+LoadResult run_closed_loop(PIRServer& server, const LoadOptions& opts, size_t clients, size_t query_count) {
+    Clock::time_point begin = Clock::now();
+    Clock::time_point measure_from = begin + chrono::duration_cast<Clock::duration>(chrono::duration<double>(opts.warmup_s));
+    Clock::time_point end = measure_from + chrono::duration_cast<Clock::duration>(chrono::duration<double>(opts.duration_s));
+    server.reset(measure_from);
+
+    vector<thread> threads;
+    for (size_t c = 0; c < clients; c++) {
+        threads.emplace_back([&, c]() {
+            Completion answered;
+            for (size_t k = c; Clock::now() < end; k += clients) {
+                server.submit(k % query_count, Clock::now(), &answered);
+                answered.wait();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    server.wait_idle();
+    // requests started in the window may finish after it, so the window is measured to the last completion
+    double elapsed = chrono::duration<double>(Clock::now() - measure_from).count();
+    return summarize("closed", clients, 0, server.latencies(), elapsed);
+}
+
+// Poisson arrivals at rate qps for warmup + duration, then the backlog is drained
+LoadResult run_open_loop(PIRServer& server, const LoadOptions& opts, double qps, size_t query_count) {
+    Clock::time_point begin = Clock::now();
+    Clock::time_point measure_from = begin + chrono::duration_cast<Clock::duration>(chrono::duration<double>(opts.warmup_s));
+    Clock::time_point end = measure_from + chrono::duration_cast<Clock::duration>(chrono::duration<double>(opts.duration_s));
+    server.reset(measure_from);
+
+    mt19937_64 rng(opts.seed);
+    exponential_distribution<double> gap(qps);
+    Clock::time_point arrival = begin;
+    for (size_t k = 0;; k++) {
+        arrival += chrono::duration_cast<Clock::duration>(chrono::duration<double>(gap(rng)));
+        if (arrival >= end) {
+            break;
+        }
+        this_thread::sleep_until(arrival);
+        server.submit(k % query_count, arrival);
+    }
+    server.wait_idle();
+    double elapsed = chrono::duration<double>(Clock::now() - measure_from).count();
+    return summarize("open", 0, qps, server.latencies(), elapsed);
+}
+
+const char* LOADGEN_CSV_HEADER = "variant,n,t,db_len,server_threads,mode,clients,target_qps,completed,elapsed_s,qps,"
+                                 "p50_ms,p99_ms,p999_ms,max_ms,mean_ms";
+
+void print_result(const LoadResult& r) {
+    printf("%-7s %8zu %10.2f %10zu %10.2f %10.3f %10.3f %10.3f %10.3f\n", r.mode.c_str(), r.clients, r.target_qps,
+           r.completed, r.qps, r.p50 * 1e3, r.p99 * 1e3, r.p999 * 1e3, r.max * 1e3);
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions opts;
+    if (parse_loadgen_options(argc, argv, opts) != 0) {
+        return 1;
+    }
+
+    EncryptionParameters parms(scheme_type::bfv);
+    parms.set_poly_modulus_degree(opts.n);
+    parms.set_coeff_modulus(CoeffModulus::BFVDefault(opts.n));
+    parms.set_plain_modulus(opts.t);
+    SEALContext context(parms);
+    if (!context.parameters_set()) {
+        cout << "ERROR: " << context.parameter_error_message() << endl;
+        return 1;
+    }
+    size_t rows, cols;
+    if (!shared_db_shape(opts.db_len, opts.variant == "vector", rows, cols)) {
+        cout << "ERROR: Database length must be a square for vector" << endl;
+        return 1;
+    }
+    size_t vec_len = rows;
+
+    KeyGenerator keygen(context);
+    SecretKey secret_key = keygen.secret_key();
+    Encryptor encryptor(context, secret_key);
+    Evaluator evaluator(context);
+    Decryptor decryptor(context, secret_key);
+
+    // the shared seeded database, as pir_crosslib and the Rust binaries generate it
+    vector<vector<Plaintext>> data = shared_db_plaintexts(shared_db_values(opts.seed, opts.db_len, opts.t), rows, cols);
+
+    cout << "Precomputing " << opts.distinct_queries << " queries..." << endl;
+    mt19937_64 rng(opts.seed);
+    vector<PIRQuery> queries(opts.distinct_queries);
+    for (auto& q : queries) {
+        q.index = rng() % opts.db_len;
+        q.col_select_vec.resize(cols);
+        if (opts.variant == "vector") {
+            q.row_select_vec.resize(vec_len);
+            populate_retrieval_vectors(q.col_select_vec, q.row_select_vec, vec_len, q.index, &encryptor);
+        } else {
+            client_populate(q.col_select_vec, cols, q.index, &encryptor);
+        }
+
+        // each query is checked once, outside the load
+        Ciphertext response = opts.variant == "vector"
+                                  ? vector_pr_answer(q.col_select_vec, q.row_select_vec, data, vec_len, &evaluator, &decryptor)
+                                  : server_compute(data[0], q.col_select_vec, cols, &evaluator, &decryptor);
+        Plaintext decrypted;
+        decryptor.decrypt(response, decrypted);
+        if (decrypted != data[q.index / cols][q.index % cols]) {
+            cout << "ERROR: Retrieved incorrect value for index " << q.index << endl;
+            return -1;
+        }
+    }
+
+    ofstream out(opts.out_path);
+    if (!out) {
+        cout << "ERROR: Could not write " << opts.out_path << endl;
+        return 1;
+    }
+    out << LOADGEN_CSV_HEADER << endl;
+    out.precision(9);
+    auto write_row = [&](const LoadResult& r) {
+        out << opts.variant << "," << opts.n << "," << opts.t << "," << opts.db_len << "," << opts.server_threads << ","
+            << r.mode << "," << r.clients << "," << r.target_qps << "," << r.completed << "," << r.elapsed_s << "," << r.qps << ","
+            << r.p50 * 1e3 << "," << r.p99 * 1e3 << "," << r.p999 * 1e3 << "," << r.max * 1e3 << "," << r.mean * 1e3 << endl;
+    };
+
+    cout << "Server: " << opts.variant << " n=" << opts.n << " db_len=" << opts.db_len << ", " << opts.server_threads
+         << " worker threads; " << opts.warmup_s << " s warm-up and " << opts.duration_s << " s measured per configuration" << endl;
+    PIRServer server(opts, &evaluator, &encryptor, data, queries);
+
+    printf("%-7s %8s %10s %10s %10s %10s %10s %10s %10s\n", "mode", "clients", "target/s", "completed", "QPS", "p50 (ms)",
+           "p99 (ms)", "p99.9 (ms)", "max (ms)");
+    double saturation = 0;
+    size_t saturation_clients = 0;
+    for (size_t clients : opts.clients) {
+        LoadResult r = run_closed_loop(server, opts, clients, queries.size());
+        print_result(r);
+        write_row(r);
+        if (r.qps > saturation) {
+            saturation = r.qps;
+            saturation_clients = clients;
+        }
+    }
+    if (!opts.clients.empty()) {
+        printf("Saturation throughput: %.2f QPS (closed loop, %zu clients)\n", saturation, saturation_clients);
+    }
+
+    // without --rates, probe below, near and at the saturation point
+    vector<double> rates = opts.rates;
+    if (rates.empty() && saturation > 0) {
+        rates = {0.5 * saturation, 0.8 * saturation, 0.95 * saturation};
+    }
+    for (double qps : rates) {
+        if (qps <= 0) {
+            continue;
+        }
+        LoadResult r = run_open_loop(server, opts, qps, queries.size());
+        print_result(r);
+        write_row(r);
+    }
+    cout << "Wrote " << opts.out_path << endl;
+    return 0;
+}
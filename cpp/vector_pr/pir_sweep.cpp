@@ -0,0 +1,337 @@
+#include "seal/seal.h"
+#include "pir_bench.h"
+#include "pir_kernels.h"
+#include "pir_pools.h"
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+using namespace std;
+using namespace seal;
+
+/*
+Non-interactive parameter sweep over TrivialPR and VectorPR. Every combination of the grid
+(n, t, coeff modulus, db_len, variant, threads) is set up from scratch, timed through
+BenchHarness, and written as one CSV row: per-phase wall times, the response's noise budget,
+whether it decrypted correctly, and the memory and message sizes. Rows are flushed as they
+finish, so a sweep that is stopped part way still leaves every completed row behind.
+
+    pir_sweep --n 4096,8192,16384 --t 1024,65537 --coeff default,36:36:37 --db-len 1600,10000 \
+              --variant trivial,vector --threads 1,4 --trials 5 --out sweep.csv
+*/
+
+struct SweepGrid {
+    vector<size_t> n = {4096, 8192, 16384};
+    vector<uint64_t> t = {1024, 65537};
+    vector<string> coeff = {"default"};     // "default" (BFVDefault) or colon-separated prime sizes
+    vector<size_t> db_len = {1600};
+    vector<string> variant = {"trivial", "vector"};
+    vector<size_t> threads = {1};
+    uint64_t seed = 1;                      // database contents and the retrieved index
+    BenchOptions bench;
+    string out_path = "sweep.csv";
+};
+
+struct SweepConfig {
+    size_t n;
+    uint64_t t;
+    string coeff;
+    size_t db_len;
+    string variant;
+    size_t threads;
+};
+
+template <typename T>
+vector<T> parse_list(const string& s) {
+    vector<T> values;
+    for (const auto& part : split(s, ',')) {
+        values.push_back((T)stoull(part));
+    }
+    return values;
+}
+
+void print_sweep_usage(const char* program) {
+    cout << "Usage: " << program << " [--n N,...] [--t T,...] [--coeff default|B:B:...,...] [--db-len L,...]" << endl;
+    cout << "       " << program << " [--variant trivial,vector] [--threads K,...] [--seed S] [--out PATH]" << endl;
+    print_bench_usage(program);
+}
+
+int parse_sweep_options(int argc, char* argv[], SweepGrid& grid) {
+    grid.bench.warmup = 1;
+    grid.bench.trials = 5;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--n" && has_value) {
+            grid.n = parse_list<size_t>(argv[++i]);
+        } else if (arg == "--t" && has_value) {
+            grid.t = parse_list<uint64_t>(argv[++i]);
+        } else if (arg == "--coeff" && has_value) {
+            grid.coeff = split(argv[++i], ',');
+        } else if (arg == "--db-len" && has_value) {
+            grid.db_len = parse_list<size_t>(argv[++i]);
+        } else if (arg == "--variant" && has_value) {
+            grid.variant = split(argv[++i], ',');
+            for (const auto& v : grid.variant) {
+                if (v != "trivial" && v != "vector") {
+                    print_sweep_usage(argv[0]);
+                    return -1;
+                }
+            }
+        } else if (arg == "--threads" && has_value) {
+            grid.threads = parse_list<size_t>(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            grid.seed = stoull(argv[++i]);
+        } else if (arg == "--out" && has_value) {
+            grid.out_path = argv[++i];
+        } else if (!parse_bench_option(argc, argv, i, grid.bench)) {
+            print_sweep_usage(argv[0]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// TrivialPR over K threads: thread k takes the k-th contiguous slice of the database into its own pool
+Ciphertext trivial_answer_threaded(vector<Plaintext>& data, vector<Ciphertext>& request, size_t threads,
+                                   Evaluator* evaluator, vector<MemoryPoolHandle>& pools) {
+    vector<Ciphertext> partials(threads);
+    vector<thread> workers;
+    for (size_t k = 0; k < threads; k++) {
+        workers.emplace_back([&, k]() {
+            size_t begin = data.size() * k / threads;
+            size_t end = data.size() * (k + 1) / threads;
+            Ciphertext partial(pools[k]);
+            Ciphertext product(pools[k]);
+            for (size_t i = begin; i < end; i++) {
+                evaluator->multiply_plain(request[i], data[i], i == begin ? partial : product, pools[k]);
+                if (i != begin) {
+                    evaluator->add_inplace(partial, product);
+                }
+            }
+            partials[k] = partial;
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    Ciphertext result = partials[0];
+    for (size_t k = 1; k < threads; k++) {
+        evaluator->add_inplace(result, partials[k]);
+    }
+    return result;
+}
+
+// VectorPR over K threads: thread k folds its contiguous range of rows (ct x pt row product, then
+// times that row's selector) into a partial sum, as a shard would
+Ciphertext vector_answer_threaded(vector<Ciphertext>& col_select_vec, vector<Ciphertext>& row_select_vec,
+                                  vector<vector<Plaintext>>& data, size_t vec_len, size_t threads,
+                                  Evaluator* evaluator, vector<MemoryPoolHandle>& pools) {
+    vector<Ciphertext> partials(threads);
+    vector<thread> workers;
+    for (size_t k = 0; k < threads; k++) {
+        workers.emplace_back([&, k]() {
+            size_t begin = vec_len * k / threads;
+            size_t end = vec_len * (k + 1) / threads;
+            Ciphertext row(pools[k]);
+            Ciphertext scratch(pools[k]);
+            Ciphertext product(pools[k]);
+            Ciphertext partial(pools[k]);
+            for (size_t i = begin; i < end; i++) {
+                vector_dot_cp_into(col_select_vec, data[i], vec_len, evaluator, row, scratch, pools[k]);
+                evaluator->multiply(row_select_vec[i], row, i == begin ? partial : product, pools[k]);
+                if (i != begin) {
+                    evaluator->add_inplace(partial, product);
+                }
+            }
+            partials[k] = partial;
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    Ciphertext result = partials[0];
+    for (size_t k = 1; k < threads; k++) {
+        evaluator->add_inplace(result, partials[k]);
+    }
+    return result;
+}
+
+const char* SWEEP_CSV_HEADER =
+    "variant,n,t,coeff_bits,q_bits,db_len,threads,trials,status,"
+    "db_init_s,query_gen_s,compute_min_s,compute_median_s,compute_p95_s,compute_p99_s,compute_cpu_s,decrypt_s,"
+    "noise_budget,correct,db_bytes,query_bytes,response_bytes,pool_bytes,peak_rss_kb";
+
+// runs one configuration and returns its CSV row; SEAL reports unusable parameters by throwing,
+// which lands in the status column instead of ending the sweep
+string run_config(const SweepConfig& cfg, const SweepGrid& grid) {
+    ostringstream row;
+    row.precision(9);
+    row << cfg.variant << "," << cfg.n << "," << cfg.t << "," << cfg.coeff << ",";
+
+    auto fail = [&](const string& status, int q_bits) {
+        string clean = status;
+        for (auto& c : clean) {
+            if (c == ',' || c == '\n') {
+                c = ';';
+            }
+        }
+        row << q_bits << "," << cfg.db_len << "," << cfg.threads << ",0," << clean << ",,,,,,,,,,,,,,,";
+        return row.str();
+    };
+
+    // the global pool keeps what earlier configurations allocated, so only its growth is charged here
+    size_t global_start = MemoryManager::GetPool().alloc_byte_count();
+    try {
+        EncryptionParameters parms(scheme_type::bfv);
+        parms.set_poly_modulus_degree(cfg.n);
+        vector<Modulus> coeff_modulus;
+        if (cfg.coeff == "default") {
+            coeff_modulus = CoeffModulus::BFVDefault(cfg.n);
+        } else {
+            vector<int> bits;
+            for (const auto& b : split(cfg.coeff, ':')) {
+                bits.push_back(stoi(b));
+            }
+            coeff_modulus = CoeffModulus::Create(cfg.n, bits);
+        }
+        int q_bits = 0;
+        for (const auto& m : coeff_modulus) {
+            q_bits += m.bit_count();
+        }
+        parms.set_coeff_modulus(coeff_modulus);
+        parms.set_plain_modulus(cfg.t);
+
+        SEALContext context(parms);
+        if (!context.parameters_set()) {
+            return fail(context.parameter_error_message(), q_bits);
+        }
+        size_t rows, cols;
+        if (!shared_db_shape(cfg.db_len, cfg.variant == "vector", rows, cols)) {
+            return fail("db_len must be a square for vector", q_bits);
+        }
+        size_t vec_len = rows;
+        if (cfg.threads < 1) {
+            return fail("threads must be at least 1", q_bits);
+        }
+
+        KeyGenerator keygen(context);
+        SecretKey secret_key = keygen.secret_key();
+        Encryptor encryptor(context, secret_key);
+        Evaluator evaluator(context);
+        Decryptor decryptor(context, secret_key);
+        BenchHarness bench("pir_sweep", grid.bench);
+        vector<MemoryPoolHandle> pools = make_task_pools(cfg.threads);
+
+        // the same seed gives the same database and index in every configuration
+        mt19937_64 rng(grid.seed);
+        size_t index = rng() % cfg.db_len;
+        vector<uint64_t> values = shared_db_values(grid.seed, cfg.db_len, cfg.t);
+        vector<vector<Plaintext>> data;
+        bench.run("db_init", [&]() { data = shared_db_plaintexts(values, rows, cols); });
+
+        vector<Ciphertext> request(cols);
+        vector<Ciphertext> row_select_vec(cfg.variant == "vector" ? vec_len : 0);
+        bench.run("query_gen", [&]() {
+            if (cfg.variant == "vector") {
+                populate_retrieval_vectors(request, row_select_vec, vec_len, index, &encryptor);
+            } else {
+                client_populate(request, cols, index, &encryptor);
+            }
+        });
+
+        Ciphertext response;
+        bench.run("compute", [&]() {
+            if (cfg.variant == "vector") {
+                response = vector_answer_threaded(request, row_select_vec, data, vec_len, cfg.threads, &evaluator, pools);
+            } else {
+                response = trivial_answer_threaded(data[0], request, cfg.threads, &evaluator, pools);
+            }
+        });
+
+        Plaintext decrypted;
+        bench.run("decrypt", [&]() { decryptor.decrypt(response, decrypted); });
+        int budget = decryptor.invariant_noise_budget(response);
+        bool correct = decrypted == data[index / cols][index % cols];
+
+        size_t db_bytes = 0;
+        for (const auto& r : data) {
+            for (const auto& pt : r) {
+                db_bytes += pt.coeff_count() * sizeof(uint64_t);
+            }
+        }
+        size_t query_bytes = 0;
+        for (const auto& ct : request) {
+            query_bytes += ct.save_size(compr_mode_type::none);
+        }
+        for (const auto& ct : row_select_vec) {
+            query_bytes += ct.save_size(compr_mode_type::none);
+        }
+        size_t pool_bytes = MemoryManager::GetPool().alloc_byte_count() - global_start;
+        for (const auto& pool : pools) {
+            pool_bytes += pool.alloc_byte_count();
+        }
+        // high-water mark of the whole process, so it only grows over the sweep
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+
+        PhaseStats compute = bench.stats("compute");
+        row << q_bits << "," << cfg.db_len << "," << cfg.threads << "," << compute.trials << ",ok,"
+            << bench.median("db_init") << "," << bench.median("query_gen") << ","
+            << compute.wall.min << "," << compute.wall.median << "," << compute.wall.p95 << "," << compute.wall.p99 << ","
+            << compute.cpu.median << "," << bench.median("decrypt") << ","
+            << budget << "," << (correct ? 1 : 0) << "," << db_bytes << "," << query_bytes << ","
+            << response.save_size(compr_mode_type::none) << "," << pool_bytes << "," << usage.ru_maxrss;
+        return row.str();
+    } catch (const exception& e) {
+        return fail(string("error: ") + e.what(), 0);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    SweepGrid grid;
+    if (parse_sweep_options(argc, argv, grid) != 0) {
+        return 1;
+    }
+
+    vector<SweepConfig> configs;
+    for (size_t n : grid.n) {
+        for (uint64_t t : grid.t) {
+            for (const auto& coeff : grid.coeff) {
+                for (size_t db_len : grid.db_len) {
+                    for (const auto& variant : grid.variant) {
+                        for (size_t threads : grid.threads) {
+                            configs.push_back({n, t, coeff, db_len, variant, threads});
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    ofstream out(grid.out_path);
+    if (!out) {
+        cout << "ERROR: Could not write " << grid.out_path << endl;
+        return 1;
+    }
+    out << SWEEP_CSV_HEADER << endl;
+    cout << "Sweeping " << configs.size() << " configurations (" << grid.bench.warmup << " warm-up, "
+         << grid.bench.trials << " trials each) into " << grid.out_path << endl;
+
+    for (size_t c = 0; c < configs.size(); c++) {
+        const SweepConfig& cfg = configs[c];
+        cout << "[" << c + 1 << "/" << configs.size() << "] " << cfg.variant << " n=" << cfg.n << " t=" << cfg.t
+             << " q=" << cfg.coeff << " db_len=" << cfg.db_len << " threads=" << cfg.threads << endl;
+        string row = run_config(cfg, grid);
+        cout << "    " << row << endl;
+        out << row << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "seal/seal.h"
+#include "pir_records.h"
+#include "pir_kernels.h"
+#include "pir_network.h"
+#include <iostream>
+#include <time.h>
+#include <cmath>
+
+using namespace std;
+using namespace seal;
+
+/*
+RecordPR: retrieves records of 1-100 KB with VectorPR.
+
+Each record is bit-packed into floor(log2 t) bits per coefficient over one or more
+plaintexts. The records form a square grid per plaintext "plane"; one VectorPR query
+selects the same grid position in every plane, and the response ciphertexts are
+relinearized back to two polynomials and switched down the modulus chain before they are sent
+back, so the download is a small multiple of the record size.
+*/
+
+int main() {
+    cout << "RecordPR" << endl;
+
+    EncryptionParameters parms(scheme_type::bfv);
+
+    // n
+    // select from 1024, 2048, 4096, 8192, 16384, 32768
+    size_t poly_modulus_degree = 32768;
+    cout << "Polynomial Modulus (n): " << poly_modulus_degree << endl;
+    parms.set_poly_modulus_degree(poly_modulus_degree);
+
+    // q
+    cout << "Coefficient Modulus (q): [ ";
+    for (Modulus m : CoeffModulus::BFVDefault(poly_modulus_degree)) {
+        cout << m.value() << " (" << m.bit_count() << " bits)" << ", ";
+    }
+    cout << "]" << endl;
+    parms.set_coeff_modulus(CoeffModulus::BFVDefault(poly_modulus_degree));
+
+    // t
+    uint64_t plain_mod = (uint64_t) pow(2, 59);
+    cout << "Plaintext Modulus (t): " << plain_mod << endl;
+    parms.set_plain_modulus(plain_mod);
+
+    SEALContext context(parms);
+
+    KeyGenerator keygen(context);
+    SecretKey secret_key = keygen.secret_key();
+
+    Encryptor encryptor(context, secret_key);
+    Evaluator evaluator(context);
+    Decryptor decryptor(context, secret_key);
+
+    // the c-c step leaves size-3 responses; relinearizing them cuts the download by a third
+    RelinKeys relin_keys;
+    keygen.create_relin_keys(relin_keys);
+
+    size_t record_bytes;
+    cout << "Input the record size in bytes (1 to 102400): " << endl;
+    cin >> record_bytes;
+
+    if (record_bytes < 1 || record_bytes > 102400) {
+        cout << "ERROR: Record size must be between 1 and 102400 bytes" << endl;
+        return 1;
+    }
+
+    size_t record_count = 64;
+    RecordLayout layout(record_bytes, poly_modulus_degree, plain_mod);
+    cout << "Records: " << record_count << ", bits per coefficient: " << layout.bits_per_coeff
+         << ", plaintexts per record: " << layout.plaintexts_per_record
+         << ", plaintext packing efficiency: " << layout.packing_efficiency() << endl;
+
+    cout << "Initializing server database..." << endl;
+
+    // Initialize random seed
+    srand(time(0));
+
+    vector<vector<uint8_t>> records(record_count, vector<uint8_t>(record_bytes));
+    for (auto& record : records) {
+        for (auto& byte : record) {
+            byte = rand() & 0xff;
+        }
+    }
+
+    // planes[p] is a square VectorPR database of the p-th plaintext of every record, padded with nonzero filler
+    clock_t start = clock();
+    size_t vec_len = (size_t) ceil(sqrt((double) record_count));
+    vector<vector<vector<Plaintext>>> planes(layout.plaintexts_per_record,
+        vector<vector<Plaintext>>(vec_len, vector<Plaintext>(vec_len, Plaintext("1"))));
+    for (size_t r = 0; r < record_count; r++) {
+        vector<Plaintext> encoded = encode_record(records[r].data(), layout);
+        for (size_t p = 0; p < layout.plaintexts_per_record; p++) {
+            planes[p][r / vec_len][r % vec_len] = encoded[p];
+        }
+    }
+    clock_t t = clock() - start;
+    printf("Time to encode records (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+    size_t index;
+    cout << "Input the index to retrieve: " << endl;
+    cin >> index;
+
+    if (index >= record_count) {
+        cout << "ERROR: Index cannot be greater than the number of records" << endl;
+        return 1;
+    }
+
+    start = clock();
+    vector<Ciphertext> col_select_vec(vec_len);
+    vector<Ciphertext> row_select_vec(vec_len);
+    populate_retrieval_vectors(col_select_vec, row_select_vec, vec_len, index, &encryptor);
+    t = clock() - start;
+    printf("Time to populate retrieval vectors (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+    // the same selectors answer every plane
+    start = clock();
+    vector<Ciphertext> responses(layout.plaintexts_per_record);
+    for (size_t p = 0; p < layout.plaintexts_per_record; p++) {
+        responses[p] = vector_pr_answer(col_select_vec, row_select_vec, planes[p], vec_len, &evaluator, &decryptor);
+    }
+    t = clock() - start;
+    printf("Time to compute responses (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+    size_t full_bytes = message_size(responses).uncompressed;
+
+    start = clock();
+    size_t dropped = 0;
+    for (auto& ct : responses) {
+        dropped += pack_response_inplace(ct, context, &evaluator, &relin_keys);
+    }
+    t = clock() - start;
+    printf("Time to pack responses (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+    // actually serialized: save_size with compression is only an upper bound
+    MessageSize packed_size = message_size(responses);
+    size_t packed_bytes = packed_size.uncompressed;
+    size_t compressed_bytes = packed_size.compressed;
+    cout << "Response: " << responses.size() << " ciphertexts of size " << responses[0].size() << ", " << dropped
+         << " primes dropped in total" << endl;
+    cout << "    unpacked: " << full_bytes << " bytes (" << (double) full_bytes / record_bytes << "x record)" << endl;
+    cout << "    packed: " << packed_bytes << " bytes (" << (double) packed_bytes / record_bytes << "x record)" << endl;
+    cout << "    packed, compressed: " << compressed_bytes << " bytes (" << (double) compressed_bytes / record_bytes << "x record)" << endl;
+    printf("Download efficiency (response bytes per record byte): %.2f packed, %.2f compressed\n",
+           (double) packed_bytes / record_bytes, (double) compressed_bytes / record_bytes);
+
+    start = clock();
+    vector<Plaintext> decrypted(responses.size());
+    for (size_t p = 0; p < responses.size(); p++) {
+        cout << "Noise budget in plane " << p << " response: " << decryptor.invariant_noise_budget(responses[p]) << " bits" << endl;
+        decryptor.decrypt(responses[p], decrypted[p]);
+    }
+    vector<uint8_t> record = decode_record(decrypted, layout);
+    t = clock() - start;
+    printf("Time to decrypt and reassemble record (s): %f\n", ((float)t)/CLOCKS_PER_SEC);
+
+    if (record != records[index]) {
+        cout << "ERROR: Retrieved incorrect record" << endl;
+        return -1;
+    }
+    cout << "Retrieved record " << index << " (" << record_bytes << " bytes)" << endl;
+
+    return 0;
+}
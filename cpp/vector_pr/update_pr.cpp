@@ -0,0 +1,152 @@
+#include "seal/seal.h"
+#include "pir_kernels.h"
+#include "pir_update.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <time.h>
+#include <cmath>
+
+using namespace std;
+using namespace seal;
+
+/*
+UpdatePR: VectorPR over a database that changes while it is being queried.
+
+A query thread keeps retrieving random indices from whatever snapshot is current while
+the main thread applies batches of (index, value) updates. Every answer must match the
+snapshot it was computed from, and each batch only re-encodes the plaintexts it changes.
+*/
+
+int main() {
+    cout << "UpdatePR" << endl;
+
+    EncryptionParameters parms(scheme_type::bfv);
+
+    // n
+    // select from 1024, 2048, 4096, 8192, 16384, 32768
+    size_t poly_modulus_degree = 32768;
+    cout << "Polynomial Modulus (n): " << poly_modulus_degree << endl;
+    parms.set_poly_modulus_degree(poly_modulus_degree);
+
+    // q
+    cout << "Coefficient Modulus (q): [ ";
+    for (Modulus m : CoeffModulus::BFVDefault(poly_modulus_degree)) {
+        cout << m.value() << " (" << m.bit_count() << " bits)" << ", ";
+    }
+    cout << "]" << endl;
+    parms.set_coeff_modulus(CoeffModulus::BFVDefault(poly_modulus_degree));
+
+    // t
+    uint64_t plain_mod = (uint64_t) pow(2, 59);
+    cout << "Plaintext Modulus (t): " << plain_mod << endl;
+    parms.set_plain_modulus(plain_mod);
+
+    SEALContext context(parms);
+
+    KeyGenerator keygen(context);
+    SecretKey secret_key = keygen.secret_key();
+
+    Encryptor encryptor(context, secret_key);
+    Evaluator evaluator(context);
+    Decryptor decryptor(context, secret_key);
+
+    size_t vec_len = 16;
+    size_t db_len = vec_len * vec_len;
+
+    cout << "Initializing server database..." << endl;
+
+    // Initialize random seed
+    srand(time(0));
+
+    clock_t start = clock();
+    vector<vector<Plaintext>> data(vec_len, vector<Plaintext>(vec_len));
+    for (size_t i = 0; i < vec_len; i++) {
+        for (size_t j = 0; j < vec_len; j++) {
+            // Value should be between 1 and plain_mod
+            uint64_t val = rand() % (plain_mod-1) + 1;
+            data[i][j] = Plaintext(seal::util::uint_to_hex_string(&val, size_t(1)));
+        }
+    }
+    clock_t t = clock() - start;
+    float rebuild_time = ((float)t)/CLOCKS_PER_SEC;
+    cout << "Size of database: " << db_len << endl;
+    printf("Time to encode full database (s): %f\n", rebuild_time);
+
+    UpdatablePIRDatabase db(data, plain_mod);
+
+    size_t batch_size;
+    cout << "Input the number of updates per batch: " << endl;
+    cin >> batch_size;
+
+    if (batch_size < 1) {
+        cout << "ERROR: Batch size should be greater than or equal to 1" << endl;
+        return 1;
+    }
+
+    // queries run against whichever snapshot is current until the updates are done
+    atomic<bool> updating(true);
+    size_t queries = 0;
+    size_t mismatches = 0;
+    uint64_t first_version = 0;
+    uint64_t last_version = 0;
+    thread query_thread([&]() {
+        unsigned seed = 1;
+        do {
+            size_t index = rand_r(&seed) % db_len;
+            vector<Ciphertext> col_select_vec(vec_len);
+            vector<Ciphertext> row_select_vec(vec_len);
+            populate_retrieval_vectors(col_select_vec, row_select_vec, vec_len, index, &encryptor);
+
+            UpdatablePIRDatabase::Snapshot snap = db.snapshot();
+            Ciphertext result = vector_pr_answer(col_select_vec, row_select_vec, snap.data(), vec_len, &evaluator, &decryptor);
+            Plaintext result_decrypted;
+            decryptor.decrypt(result, result_decrypted);
+            if (result_decrypted != snap.data()[index / vec_len][index % vec_len]) {
+                mismatches++;
+            }
+            if (queries++ == 0) {
+                first_version = snap.version();
+            }
+            last_version = snap.version();
+        } while (updating.load());
+    });
+
+    size_t batches = 20;
+    float total_apply_time = 0;
+    float max_apply_time = 0;
+    for (size_t b = 0; b < batches; b++) {
+        vector<PIRUpdate> updates(batch_size);
+        for (auto& u : updates) {
+            u.index = rand() % db_len;
+            u.value = rand() % (plain_mod-1) + 1;
+        }
+        auto wall_start = chrono::steady_clock::now();
+        if (db.apply(updates) != 0) {
+            updating = false;
+            query_thread.join();
+            return -1;
+        }
+        float apply_time = chrono::duration<float>(chrono::steady_clock::now() - wall_start).count();
+        total_apply_time += apply_time;
+        max_apply_time = max(max_apply_time, apply_time);
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+    updating = false;
+    query_thread.join();
+
+    printf("Applied %zu batches of %zu updates\n", batches, batch_size);
+    printf("Mean time to apply a batch (s): %f\n", total_apply_time / batches);
+    printf("Max time to apply a batch, including grace period (s): %f\n", max_apply_time);
+    printf("Full re-encode of the database (s): %f\n", rebuild_time);
+    cout << "Queries answered during updates: " << queries << " (snapshot versions " << first_version << " to " << last_version << ")" << endl;
+
+    if (mismatches != 0) {
+        cout << "ERROR: " << mismatches << " answers did not match their snapshot" << endl;
+        return -1;
+    }
+    cout << "Every answer matched its snapshot" << endl;
+
+    return 0;
+}
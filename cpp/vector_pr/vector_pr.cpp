@@ -1,4 +1,13 @@
 #include "seal/seal.h"
+#include "pir_arena.h"
+#include "pir_bench.h"
+#include "pir_db_file.h"
+#include "pir_fused.h"
+#include "pir_kernels.h"
+#include "pir_memory.h"
+#include "pir_options.h"
+#include "pir_shard.h"
+#include "pir_stream.h"
 #include <iostream>
 #include <time.h>
 #include <cmath>
@@ -6,9 +15,6 @@
 using namespace std;
 using namespace seal;
 
-Ciphertext vector_dot_cp(vector<Ciphertext>& col_select_vec, vector<Plaintext>& row_select_vec, size_t len, Evaluator* evaluator, Decryptor* d);
-Ciphertext vector_dot_cc(vector<Ciphertext>& col_select_vec, vector<Ciphertext>& row_select_vec, size_t len, Evaluator* evaluator, Decryptor* d);
-void populate_retrieval_vectors(vector<Ciphertext>& col_select_vec, vector<Ciphertext>& row_select_vec, int vec_len, int index, Encryptor* encryptor);
 void print_plainvec(const vector<Plaintext>& vec);
 
 /*
@@ -33,9 +39,25 @@ Result = TempVec * row_select_vec = 3
 
 */
 
-int main() {
+int main(int argc, char* argv[]) {
     cout << "VectorPR" << endl;
 
+    // database file options, see print_db_usage
+    DBOptions db_opts;
+    if (parse_db_options(argc, argv, db_opts) != 0) {
+        return 1;
+    }
+#ifndef PIR_COUNT_ALLOCATIONS
+    // counting replaces the global allocator, so only the vector_pr_check_alloc build does it
+    if (db_opts.check_alloc) {
+        cout << "ERROR: --check-alloc needs vector_pr_check_alloc, the build that counts heap allocations" << endl;
+        return 1;
+    }
+#endif
+
+    // every phase is timed on the wall clock, repeated as --warmup / --trials ask
+    BenchHarness bench("vector_pr", db_opts.bench);
+
     EncryptionParameters parms(scheme_type::bfv);
 
     // n
@@ -58,6 +80,8 @@ int main() {
     parms.set_plain_modulus(plain_mod);
 
     SEALContext context(parms);
+    bench.note("n", poly_modulus_degree);
+    bench.note("t", plain_mod);
 
     KeyGenerator keygen(context);
     SecretKey secret_key = keygen.secret_key();
@@ -70,35 +94,88 @@ int main() {
     // Sizes: 64
     size_t db_len = 1600; // 1,000,000, 490k, 90000, 40000, 10000, 64
     size_t vec_len = (size_t) sqrt((float) db_len);
+
+    // initialize arrays
+    // use vectors instead of arrays
+    vector<vector<Plaintext>> data;
+    MappedPIRDatabase db;
+    PlacedPIRDatabase placed_db;
+
+    if (!db_opts.load_db_path.empty()) {
+        cout << "Mapping server database file..." << endl;
+        if (bench.run("db_init", [&]() { return db.open(db_opts.load_db_path, context, db_opts.verify) != 0 || db.rows() != db.cols() ? -1 : 0; }) != 0) {
+            cout << "ERROR: Could not load square database from " << db_opts.load_db_path << endl;
+            return -1;
+        }
+        vec_len = db.rows();
+        db_len = vec_len * vec_len;
+        printf("Time to map server database file (s): %f\n", bench.median("db_init"));
+
+        // mapping reads nothing yet, but a mapped scan faults the whole file in and placement
+        // copies it; --stream keeps only its two chunk buffers resident
+        size_t db_file_bytes = file_bytes(db_opts.load_db_path);
+        size_t ct_bytes = fresh_ciphertext_bytes(context);
+        estimate_fits({{"database", db_opts.stream ? 0 : db_file_bytes},
+                       {"stream buffers", db_opts.stream ? 2 * PIR_STREAM_CHUNK_BYTES : 0},
+                       {"placed copy", db_opts.placed ? db_file_bytes : 0},
+                       {"query", 2 * vec_len * ct_bytes},
+                       {"intermediate_vec", vec_len * ct_bytes}});
+
+        if (db_opts.placed) {
+            cout << "Placing server database in memory..." << endl;
+            // placement binds and faults in fresh memory, so it is measured once
+            PhaseTimer timer;
+            if (placed_db.load(db, db_opts.placement) != 0) {
+                return -1;
+            }
+            bench.record("db_place", timer.elapsed());
+            cout << "NUMA nodes: " << placed_db.nodes() << ", huge pages: " << (placed_db.huge_pages() ? "yes" : "no") << endl;
+            printf("Time to place server database (s): %f\n", bench.median("db_place"));
+        }
+    }
     if (db_len != vec_len * vec_len) {
         cout << "Error: Database length must be a square" << endl;
         return -1;
     }
 
-    // initialize arrays
-    // use vectors instead of arrays
-    vector<vector<Plaintext>> data(vec_len);
-
     // name variables more intuitively
     vector<Ciphertext> col_select_vec(vec_len);
     vector<Ciphertext> row_select_vec(vec_len);
 
-    cout << "Initializing server data array..." << endl;
-
-    // Initialize random seed
-    srand(time(0));
-
-    // ======= initialize 2d database vector ===========
-    for (int i = 0; i < vec_len; i++) {
-        vector<Plaintext> temp(vec_len);
-        for (int j = 0; j < vec_len; j++) {
-            // Value should be between 1 and plain_mod
-            uint64_t val = rand() % (plain_mod-1) + 1;
-            // encrypt i
-            Plaintext i_plain(seal::util::uint_to_hex_string(&val, size_t(1)));
-            temp[j] = i_plain;
+    if (db_opts.load_db_path.empty()) {
+        size_t ct_bytes = fresh_ciphertext_bytes(context);
+        estimate_fits({{"database", db_len * generated_plaintext_bytes()},
+                       {"query", 2 * vec_len * ct_bytes},
+                       {"intermediate_vec", vec_len * ct_bytes}});
+        data.resize(vec_len);
+
+        cout << "Initializing server data array..." << endl;
+
+        // Initialize random seed
+        srand(time(0));
+
+        // ======= initialize 2d database vector ===========
+        bench.run("db_init", [&]() {
+            for (int i = 0; i < vec_len; i++) {
+                vector<Plaintext> temp(vec_len);
+                for (int j = 0; j < vec_len; j++) {
+                    // Value should be between 1 and plain_mod
+                    uint64_t val = rand() % (plain_mod-1) + 1;
+                    // encrypt i
+                    Plaintext i_plain(seal::util::uint_to_hex_string(&val, size_t(1)));
+                    temp[j] = i_plain;
+                }
+                data[i] = temp;
+            }
+        });
+        printf("Time to initialize server data array (s): %f\n", bench.median("db_init"));
+
+        if (!db_opts.save_db_path.empty()) {
+            cout << "Writing server database file..." << endl;
+            if (write_pir_db(db_opts.save_db_path, context, data, db_opts.ntt, &evaluator, context.first_parms_id()) != 0) {
+                return -1;
+            }
         }
-        data[i] = temp;
     }
 
     // pretty print 2d vector
@@ -108,6 +185,7 @@ int main() {
     // }
 
     cout << "Size of database: " << db_len << endl;
+    bench.note("db_len", db_len);
 
     size_t index;
     cout << "Input the index to retreive: " << endl;
@@ -120,7 +198,8 @@ int main() {
 
     cout << "Populating client retrieval vectors..." << endl;
 
-    populate_retrieval_vectors(col_select_vec, row_select_vec, vec_len, index, &encryptor);
+    bench.run("query_gen", [&]() { populate_retrieval_vectors(col_select_vec, row_select_vec, vec_len, index, &encryptor); });
+    printf("Time to populate client retrieval vectors (s): %f\n", bench.median("query_gen"));
 
     cout << "Computing dot product of columns..." << endl;
 
@@ -133,12 +212,42 @@ int main() {
 
     // multiply vector1 with database
     vector<Ciphertext> intermediate_vec(vec_len);
-    clock_t cp_start = clock();
-    for (int i = 0; i < vec_len; i++) {
-        intermediate_vec[i] = vector_dot_cp(col_select_vec, data[i], vec_len, &evaluator, &decryptor);
+    int status = bench.run("compute_cp", [&]() {
+        if (db_opts.load_db_path.empty()) {
+            for (int i = 0; i < vec_len; i++) {
+                intermediate_vec[i] = vector_dot_cp(col_select_vec, data[i], vec_len, &evaluator, &decryptor);
+            }
+            return 0;
+        }
+        // pre-NTT'd databases are multiplied against the query in NTT form
+        vector<Ciphertext> col_select_query(col_select_vec);
+        if (db.is_ntt_form()) {
+            for (auto& ct : col_select_query) {
+                evaluator.transform_to_ntt_inplace(ct);
+            }
+        }
+        if (db_opts.placed) {
+            intermediate_vec = placed_dot_products(placed_db, col_select_query, context, &evaluator);
+        } else if (db_opts.stream) {
+            PIRDatabaseStream stream;
+            if (stream.open(db_opts.load_db_path, context) != 0) {
+                return -1;
+            }
+            intermediate_vec = stream_dot_products(stream, col_select_query, context, &evaluator);
+            if (intermediate_vec.size() != vec_len) {
+                return -1;
+            }
+        } else {
+            for (int i = 0; i < vec_len; i++) {
+                intermediate_vec[i] = dot_product_mapped(col_select_query, db, i, context, &evaluator);
+            }
+        }
+        return 0;
+    });
+    if (status != 0) {
+        return -1;
     }
-    clock_t t1 = clock() - cp_start;
-    float cp_comptime = ((float)t1)/CLOCKS_PER_SEC;
+    double cp_comptime = bench.median("compute_cp");
     printf("Time to compute ciphertext-plaintext dot product (s): %f\n", cp_comptime);
 
     // print intermediate_vec for debugging
@@ -155,31 +264,105 @@ int main() {
     // }
     // print_plainvec(vec2_debug);
 
+    // relin keys exist only when the policy uses them, since shipping them to the server is the cost being decided
+    RelinKeys relin_keys;
+    if (db_opts.relin != RelinPolicy::never || db_opts.relin_compare) {
+        cout << "Generating relinearization keys..." << endl;
+        bench.run("relin_keygen", [&]() { keygen.create_relin_keys(relin_keys); });
+        printf("Time to generate relinearization keys (s): %f\n", bench.median("relin_keygen"));
+        cout << "Relinearization key size (bytes): " << relin_keys.save_size(compr_mode_type::none) << endl;
+    }
+
     cout << "Computing dot product of rows..." << endl;
     // multiply vector2 with above result
-    clock_t cc_start = clock();
-    Ciphertext retrieved = vector_dot_cc(row_select_vec, intermediate_vec, vec_len, &evaluator, &decryptor);
-    clock_t t2 = clock() - cc_start;
-    float cc_comptime = ((float)t2)/CLOCKS_PER_SEC;
+    Ciphertext retrieved;
+    bench.run("compute_cc", [&]() {
+        retrieved = vector_dot_cc(row_select_vec, intermediate_vec, vec_len, &evaluator, &decryptor,
+                                  db_opts.relin == RelinPolicy::per_product ? &relin_keys : nullptr);
+        if (db_opts.relin == RelinPolicy::end) {
+            TraceScope span("finish_response");
+            evaluator.relinearize_inplace(retrieved, relin_keys);
+        }
+    });
+    double cc_comptime = bench.median("compute_cc");
     printf("Time to compute ciphertext-ciphertext dot product (s): %f\n", cc_comptime);
 
-    float total = cp_comptime + cc_comptime;
+    double total = cp_comptime + cc_comptime;
     printf("Total retrieval time (s): %f\n", total);
 
-    // Relinearize result
-    // cout << "Relinearizing result ciphertext..." << endl;
-    // RelinKeys relin_keys;
-    // keygen.create_relin_keys(relin_keys);
-    // evaluator.relinearize_inplace(retrieved, relin_keys);
+    // what every retrieval path below must decrypt to
+    Plaintext expected = db_opts.load_db_path.empty() ? data[index / vec_len][index % vec_len] : db.plaintext(index / vec_len, index % vec_len, context);
+
+    if (db_opts.relin_compare) {
+        cout << "Comparing relinearization policies..." << endl;
+        printf("%-12s %16s %16s %16s %12s\n", "policy", "server (s)", "response (B)", "decrypt (s)", "budget");
+
+        const char* names[] = {"never", "end", "per-product"};
+        RelinPolicy policies[] = {RelinPolicy::never, RelinPolicy::end, RelinPolicy::per_product};
+        for (size_t p = 0; p < 3; p++) {
+            string phase = string("compute_cc_relin_") + names[p];
+            Ciphertext response;
+            bench.run(phase, [&]() {
+                response = vector_dot_cc(row_select_vec, intermediate_vec, vec_len, &evaluator, &decryptor,
+                                         policies[p] == RelinPolicy::per_product ? &relin_keys : nullptr);
+                if (policies[p] == RelinPolicy::end) {
+                    TraceScope span("finish_response");
+                    evaluator.relinearize_inplace(response, relin_keys);
+                }
+            });
+            double server_time = bench.median(phase);
+
+            Plaintext decrypted;
+            bench.run("decrypt_relin_" + string(names[p]), [&]() { decryptor.decrypt(response, decrypted); });
+            double decrypt_time = bench.median("decrypt_relin_" + string(names[p]));
+
+            printf("%-12s %16f %16lld %16f %12d\n", names[p], server_time, (long long)response.save_size(compr_mode_type::none),
+                   decrypt_time, decryptor.invariant_noise_budget(response));
+            if (decrypted != expected) {
+                cout << "ERROR: Relinearization policy " << names[p] << " retrieved an incorrect value" << endl;
+                return -1;
+            }
+        }
+    }
+
+    if (db_opts.fused_cc) {
+        // same inner product with the tensors summed before a single scale-and-round
+        Ciphertext fused;
+        if (bench.run("compute_cc_fused", [&]() { return vector_dot_cc_fused(row_select_vec, intermediate_vec, vec_len, context, fused); }) != 0) {
+            return -1;
+        }
+        double fused_comptime = bench.median("compute_cc_fused");
+        printf("Time to compute fused ciphertext-ciphertext dot product (s): %f\n", fused_comptime);
+        printf("Fused ct x ct speedup: %fx\n", cc_comptime / fused_comptime);
+
+        Plaintext fused_decrypted;
+        Plaintext loop_decrypted;
+        decryptor.decrypt(fused, fused_decrypted);
+        decryptor.decrypt(retrieved, loop_decrypted);
+        cout << "    + noise budget, loop: " << decryptor.invariant_noise_budget(retrieved) << " bits, fused: "
+             << decryptor.invariant_noise_budget(fused) << " bits" << endl;
+        if (fused_decrypted != loop_decrypted) {
+            cout << "ERROR: Fused inner product does not match vector_dot_cc" << endl;
+            return -1;
+        }
+    }
 
     // decrypt result
     Plaintext result_decrypted;
-    decryptor.decrypt(retrieved, result_decrypted);
+    bench.run("decrypt", [&]() { decryptor.decrypt(retrieved, result_decrypted); });
+    printf("Time to decrypt result (s): %f\n", bench.median("decrypt"));
+    cout << "Response size (bytes): " << retrieved.save_size(compr_mode_type::none) << endl;
+
+    cout << "Measuring serialized query and response..." << endl;
+    MessageSize upload = message_size(col_select_vec);
+    upload += message_size(row_select_vec);
+    report_communication(bench, db_opts.network, upload, message_size(&retrieved, 1),
+                         bench.median("query_gen") + bench.median("decrypt"), total);
 
     // Verify correct decryption result
-    if (result_decrypted != data[index / vec_len][index % vec_len]) {
+    if (result_decrypted != expected) {
         cout << "ERROR: Retrieved incorrect value" << endl;
-        cout << "Expected 0x" << data[index / vec_len][index % vec_len].to_string() << endl;
+        cout << "Expected 0x" << expected.to_string() << endl;
         cout << "Retrieved 0x" << result_decrypted.to_string() << endl;
         return -1;
     }
@@ -189,44 +372,98 @@ int main() {
     cout << "    + noise budget in encrypted x after computation: " << decryptor.invariant_noise_budget(retrieved) << " bits"
          << endl;
 
-    return 0;
-}
-
-Ciphertext vector_dot_cp(vector<Ciphertext>& col_select_vec, vector<Plaintext>& row_select_vec, size_t len, Evaluator* evaluator, Decryptor* d) {
-    Ciphertext result;
-    if (len < 1) {
-        cout << "ERROR: Vector length should be greater than or equal to 1" << endl;
-        return result;
+    if (db_opts.check_alloc) {
+        cout << "Checking steady-state allocations..." << endl;
+
+        // intermediates, result and scratch all live in one pre-reserved arena pool
+        CiphertextArena intermediates(context, context.first_parms_id(), vec_len);
+        CiphertextArena work(context, context.first_parms_id(), 3, 3, intermediates.pool());
+        Ciphertext& answer = work[0];
+        auto run_query = [&]() {
+            for (size_t i = 0; i < vec_len; i++) {
+                vector_dot_cp_into(col_select_vec, data[i], vec_len, &evaluator, intermediates[i], work[1], intermediates.pool());
+            }
+            vector_dot_cc_into(row_select_vec, intermediates.ciphertexts(), vec_len, &evaluator, answer, work[2], nullptr, intermediates.pool());
+        };
+
+        // the first query fills the pool's free lists
+        run_query();
+        size_t steady_queries = 3;
+        vector<MemoryPoolHandle> pools = {intermediates.pool(), MemoryManager::GetPool()};
+        AllocationSnapshot before = allocation_snapshot(pools);
+        for (size_t q = 0; q < steady_queries; q++) {
+            run_query();
+        }
+        AllocationSnapshot after = allocation_snapshot(pools);
+
+        size_t heap = after.heap_allocations - before.heap_allocations;
+        size_t pool_growth = after.pool_bytes - before.pool_bytes;
+        cout << "Heap allocations over " << steady_queries << " steady-state queries: " << heap
+             << ", pool growth: " << pool_growth << " bytes, arena pool: " << after.pool_bytes << " bytes" << endl;
+
+        Plaintext arena_decrypted;
+        decryptor.decrypt(answer, arena_decrypted);
+        if (arena_decrypted != expected) {
+            cout << "ERROR: Arena retrieval returned an incorrect value" << endl;
+            return -1;
+        }
+        if (heap != 0 || pool_growth != 0) {
+            cout << "ERROR: Steady-state queries allocated memory" << endl;
+            return -1;
+        }
     }
 
-    evaluator->multiply_plain(col_select_vec[0], row_select_vec[0], result);
-    for (size_t j = 1; j < len; j++) {
-        Ciphertext temp;
-        evaluator->multiply_plain(col_select_vec[j], row_select_vec[j], temp);
-        // cout << "intermediate budget: " << d->invariant_noise_budget(temp) << endl;
-        evaluator->add_inplace(result, temp);
-        // cout << "Out_data budget: " << d->invariant_noise_budget(result) << endl;
+    if (db_opts.pipeline) {
+        cout << "Retrieving again with the streaming pipeline..." << endl;
+
+        // producers and consumers run concurrently, so compare against the sum of the two stages above
+        size_t peak_rows = 0;
+        Ciphertext pipelined;
+        bench.run("compute_pipelined", [&]() {
+            pipelined = vector_pr_answer_pipelined(col_select_vec, row_select_vec, data, vec_len, &evaluator,
+                                                   db_opts.pipeline, 1, &peak_rows);
+        });
+        printf("Time for pipelined retrieval with %zu producers (s): %f\n", db_opts.pipeline, bench.median("compute_pipelined"));
+        cout << "Peak row ciphertexts held: " << peak_rows << " (vs " << vec_len << " for intermediate_vec)" << endl;
+
+        Plaintext pipelined_decrypted;
+        decryptor.decrypt(pipelined, pipelined_decrypted);
+        if (pipelined_decrypted != expected) {
+            cout << "ERROR: Pipelined retrieval returned an incorrect value" << endl;
+            return -1;
+        }
     }
-    return result;
-}
 
-Ciphertext vector_dot_cc(vector<Ciphertext>& col_select_vec, vector<Ciphertext>& row_select_vec, size_t len, Evaluator* evaluator, Decryptor* d) {
-    Ciphertext result;
-    if (len < 1) {
-        cout << "ERROR: Vector length should be greater than or equal to 1" << endl;
-        return result;
-    }
-    
-    evaluator->multiply(col_select_vec[0], row_select_vec[0], result);
-    for (size_t j = 1; j < len; j++) {
-        Ciphertext temp;
-        // cout << "before (col, vec): " << d->invariant_noise_budget(col_select_vec[j]) << ", " << d->invariant_noise_budget(row_select_vec[j]) << endl;
-        evaluator->multiply(col_select_vec[j], row_select_vec[j], temp);
-        // cout << "c-c intermediate budget: " << d->invariant_noise_budget(temp) << endl;
-        evaluator->add_inplace(result, temp);
-        // cout << "c-c Out_data budget: " << d->invariant_noise_budget(result) << endl;
+    if (db_opts.shards) {
+        cout << "Retrieving again from " << db_opts.shards << " shard workers..." << endl;
+
+        ShardCluster cluster;
+        if (cluster.start_vector(data, db_opts.shards, context, &evaluator) != 0) {
+            return -1;
+        }
+        // both stages run in the worker processes, so the CPU time here is only the coordinator's
+        Ciphertext sharded;
+        if (bench.run("compute_sharded", [&]() { return cluster.answer(col_select_vec, row_select_vec, &evaluator, sharded); }) != 0) {
+            return -1;
+        }
+        printf("Time to retrieve across %zu shards (s): %f\n", cluster.shards(), bench.median("compute_sharded"));
+
+        Plaintext sharded_decrypted;
+        decryptor.decrypt(sharded, sharded_decrypted);
+        if (sharded_decrypted != expected) {
+            cout << "ERROR: Sharded retrieval returned an incorrect value" << endl;
+            return -1;
+        }
     }
-    return result;
+
+    MemoryReport memory;
+    memory.add("database", db_opts.load_db_path.empty() ? held_bytes(data) : db.header().data_bytes);
+    memory.add("query", held_bytes(col_select_vec) + held_bytes(row_select_vec));
+    memory.add("intermediate_vec", held_bytes(intermediate_vec));
+    memory.add("response", held_bytes(retrieved));
+    memory.report(bench);
+
+    return bench.report() != 0 ? -1 : 0;
 }
 
 void print_plainvec(const vector<Plaintext>& vec) {
@@ -236,30 +473,3 @@ void print_plainvec(const vector<Plaintext>& vec) {
     }
     cout << "]" << endl;
 }
-
-void populate_retrieval_vectors(vector<Ciphertext>& col_select_vec, vector<Ciphertext>& row_select_vec, int vec_len, int index, Encryptor* encryptor) {
-    Ciphertext encrypted_zero;
-    Ciphertext encrypted_one;
-    encryptor->encrypt_symmetric(Plaintext("0"), encrypted_zero);
-    encryptor->encrypt_symmetric(Plaintext("1"), encrypted_one);
-
-    // vector 1 is dotted with columns of database
-    // vector 2 is dotted with (col_select_vec * DB)
-    size_t row = index / vec_len;
-    size_t col = index % vec_len;
-
-    cout << "Populating vectors..." << endl;
-    for (int i = 0; i < vec_len; i++) {
-        if (i == col) {
-            col_select_vec[i] = encrypted_one;
-        } else {
-            col_select_vec[i] = encrypted_zero;
-        }
-
-        if (i == row) {
-            row_select_vec[i] = encrypted_one;
-        } else {
-            row_select_vec[i] = encrypted_zero;
-        }
-    }
-}
\ No newline at end of file
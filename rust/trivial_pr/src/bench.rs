@@ -0,0 +1,173 @@
+// BENCHMARK PLUMBING (mirrors cpp/common/pir_bench.h so results from both libraries line up)
+use crate::util::DisplayDuration;
+use std::{fs::File, io::Write, time::Duration, time::Instant};
+
+/// Command line options shared with the C++ pir_crosslib binary. Anything not given keeps the
+/// constants in main.rs, and without --index the index is read from stdin as before.
+pub struct Args {
+	pub n: usize,
+	pub t: u64,
+	pub moduli: Vec<u64>,
+	pub len: usize,
+	pub seed: Option<u64>,
+	pub index: Option<usize>,
+	pub warmup: usize,
+	pub trials: usize,
+	pub json: Option<String>,
+}
+
+impl Args {
+	pub fn parse(n: usize, t: u64, moduli: &[u64], len: usize) -> Args {
+		let mut args = Args {
+			n,
+			t,
+			moduli: moduli.to_vec(),
+			len,
+			seed: None,
+			index: None,
+			warmup: 0,
+			trials: 1,
+			json: None,
+		};
+		let argv: Vec<String> = std::env::args().collect();
+		let mut i = 1;
+		while i < argv.len() {
+			let value = argv.get(i + 1).map(|v| v.as_str());
+			match (argv[i].as_str(), value) {
+				("--n", Some(v)) => args.n = parse_u64(v) as usize,
+				("--t", Some(v)) => args.t = parse_u64(v),
+				("--moduli", Some(v)) => args.moduli = v.split(',').map(parse_u64).collect(),
+				("--len", Some(v)) => args.len = parse_u64(v) as usize,
+				("--seed", Some(v)) => args.seed = Some(parse_u64(v)),
+				("--index", Some(v)) => args.index = Some(parse_u64(v) as usize),
+				("--warmup", Some(v)) => args.warmup = parse_u64(v) as usize,
+				("--trials", Some(v)) => args.trials = (parse_u64(v) as usize).max(1),
+				("--bench-json", Some(v)) => args.json = Some(v.to_string()),
+				_ => {
+					println!("Usage: {} [--n N] [--t T] [--moduli Q,...] [--len L] [--seed S] [--index I]", argv[0]);
+					println!("       {} [--warmup W] [--trials N] [--bench-json PATH]", argv[0]);
+					std::process::exit(1);
+				}
+			}
+			i += 2;
+		}
+		args
+	}
+}
+
+fn parse_u64(v: &str) -> u64 {
+	let parsed = match v.strip_prefix("0x") {
+		Some(hex) => u64::from_str_radix(hex, 16),
+		None => v.parse::<u64>(),
+	};
+	parsed.unwrap_or_else(|_| panic!("ERROR: {} is not an integer", v))
+}
+
+/// splitmix64, the same generator as splitmix64() in pir_bench.h
+pub fn splitmix64(state: &mut u64) -> u64 {
+	*state = state.wrapping_add(0x9e3779b97f4a7c15);
+	let mut z = *state;
+	z = (z ^ (z >> 30)).wrapping_mul(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)).wrapping_mul(0x94d049bb133111eb);
+	z ^ (z >> 31)
+}
+
+/// count database values between 1 and plain_modulus - 1, in row-major order
+pub fn shared_db_values(seed: u64, count: usize, plain_modulus: u64) -> Vec<u64> {
+	let mut state = seed;
+	(0..count).map(|_| splitmix64(&mut state) % (plain_modulus - 1) + 1).collect()
+}
+
+/// Runs each phase `warmup` times untimed, then `trials` times under a wall-clock timer, and
+/// writes the same JSON report as BenchHarness. Rust's standard library has no process CPU
+/// clock, so "cpu_s" is null.
+pub struct Bench {
+	program: String,
+	warmup: usize,
+	trials: usize,
+	params: Vec<(String, String)>,
+	phases: Vec<(String, Vec<Duration>)>,
+}
+
+impl Bench {
+	pub fn new(program: &str, args: &Args) -> Bench {
+		Bench {
+			program: program.to_string(),
+			warmup: args.warmup,
+			trials: args.trials,
+			params: vec![],
+			phases: vec![],
+		}
+	}
+
+	pub fn note<T: std::fmt::Display>(&mut self, key: &str, value: T) {
+		self.params.push((key.to_string(), value.to_string()));
+	}
+
+	pub fn note_str(&mut self, key: &str, value: &str) {
+		self.params.push((key.to_string(), format!("\"{}\"", value)));
+	}
+
+	/// returns what the last timed run returned
+	pub fn run<T, F: FnMut() -> T>(&mut self, phase: &str, mut f: F) -> T {
+		for _ in 0..self.warmup {
+			f();
+		}
+		let mut samples = vec![];
+		let mut last = None;
+		for _ in 0..self.trials {
+			let start = Instant::now();
+			last = Some(f());
+			samples.push(start.elapsed());
+		}
+		self.phases.push((phase.to_string(), samples));
+		println!("⏱  {}: {}", phase, DisplayDuration(self.stats(phase)[1]));
+		last.unwrap()
+	}
+
+	/// min, median, p95, p99 and mean, nearest-rank as in sample_stats()
+	fn stats(&self, phase: &str) -> [Duration; 5] {
+		let mut samples = self
+			.phases
+			.iter()
+			.find(|p| p.0 == phase)
+			.map(|p| p.1.clone())
+			.unwrap_or_default();
+		if samples.is_empty() {
+			return [Duration::ZERO; 5];
+		}
+		samples.sort();
+		let rank = |p: f64| {
+			let r = (p * samples.len() as f64).ceil() as usize;
+			samples[r.clamp(1, samples.len()) - 1]
+		};
+		let mean = samples.iter().sum::<Duration>() / samples.len() as u32;
+		[samples[0], rank(0.5), rank(0.95), rank(0.99), mean]
+	}
+
+	pub fn write_json(&self, path: &str) -> std::io::Result<()> {
+		let mut out = File::create(path)?;
+		writeln!(out, "{{\n  \"program\": \"{}\",", self.program)?;
+		writeln!(out, "  \"warmup\": {},\n  \"trials\": {},", self.warmup, self.trials)?;
+		let params: Vec<String> = self.params.iter().map(|(k, v)| format!("\"{}\": {}", k, v)).collect();
+		write!(out, "  \"params\": {{{}}},\n  \"phases\": [", params.join(", "))?;
+		for (i, (name, samples)) in self.phases.iter().enumerate() {
+			let s = self.stats(name);
+			let wall: Vec<String> = samples.iter().map(|d| format!("{}", d.as_secs_f64())).collect();
+			write!(
+				out,
+				"{}\n    {{\"name\": \"{}\", \"trials\": {}, \"wall_s\": {{\"min\": {}, \"median\": {}, \"p95\": {}, \"p99\": {}, \"mean\": {}}}, \"cpu_s\": null, \"samples_wall_s\": [{}]}}",
+				if i > 0 { "," } else { "" },
+				name,
+				samples.len(),
+				s[0].as_secs_f64(),
+				s[1].as_secs_f64(),
+				s[2].as_secs_f64(),
+				s[3].as_secs_f64(),
+				s[4].as_secs_f64(),
+				wall.join(", ")
+			)?;
+		}
+		writeln!(out, "\n  ]\n}}")
+	}
+}
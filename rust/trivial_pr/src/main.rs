@@ -1,21 +1,26 @@
+mod bench;
 mod util;
 
+use bench::{shared_db_values, Args, Bench};
 use fhe::bfv::{BfvParametersBuilder, BfvParameters, Ciphertext, Encoding, Plaintext, PublicKey, SecretKey, self};
 use fhe_traits::*;
 use rand::{rngs::OsRng, thread_rng, rngs::ThreadRng, Rng};
 use std::sync::Arc;
-use util::timing::{timeit, timeit_n};
 
 fn main() {
     const POLY_DEG: usize = 2048;
     let cipher_mod: &[u64] = &[0x3fffffff000001];
     const PLAIN_MOD: u64 = 1 << 10;
+    const LEN: usize = 100;
+
+    // the constants above, unless overridden on the command line (see bench::Args)
+    let args = Args::parse(POLY_DEG, PLAIN_MOD, cipher_mod, LEN);
 
     let parameters = Arc::new(
         BfvParametersBuilder::new()
-            .set_degree(POLY_DEG)
-            .set_moduli(cipher_mod)
-            .set_plaintext_modulus(PLAIN_MOD)
+            .set_degree(args.n)
+            .set_moduli(&args.moduli)
+            .set_plaintext_modulus(args.t)
             .build()
             .unwrap(),
     );
@@ -26,31 +31,57 @@ fn main() {
 
     let plaintext_0 = Plaintext::try_encode(&[0_u64], Encoding::poly(), &parameters).unwrap();
     let ciphertext_0: Ciphertext = secret_key.try_encrypt(&plaintext_0, &mut rng).unwrap();
-    
-    const LEN: usize = 100;
 
-    let mut data = vec![];
-
-    timeit!("Database creation",
-        for _i in 0..LEN {
-            let rand_val: i64 = rng.gen_range(1..PLAIN_MOD).try_into().unwrap();
-            let p = Plaintext::try_encode(&[rand_val], Encoding::poly(), &parameters).unwrap();
-            data.push(p);
+    let mut bench = Bench::new("trivial_pr_rust", &args);
+    // without --seed the database is random, as before
+    let seed = args.seed.unwrap_or_else(|| rng.gen());
+    let moduli: Vec<String> = args.moduli.iter().map(|q| q.to_string()).collect();
+    bench.note_str("library", "fhe.rs");
+    bench.note_str("variant", "trivial");
+    bench.note("n", args.n);
+    bench.note("t", args.t);
+    bench.note_str("moduli", &moduli.join(","));
+    bench.note("len", args.len);
+    bench.note("seed", seed);
+
+    let values = shared_db_values(seed, args.len, args.t);
+    let data: Vec<Plaintext> = bench.run("db_init", || {
+        values
+            .iter()
+            .map(|v| Plaintext::try_encode(&[*v], Encoding::poly(), &parameters).unwrap())
+            .collect()
+    });
+
+    let mut client_vec = vec![ciphertext_0.clone(); args.len];
+
+    let i = match args.index {
+        Some(i) => i,
+        None => {
+            println!("Input the index to retreive: ");
+            let mut input = String::new();
+            std::io::stdin().read_line(&mut input).expect("Invalid input");
+
+            let trimmed = input.trim();
+            trimmed.parse::<usize>().expect("Please input an integer...")
         }
-    );
-
-    let mut client_vec = vec![ciphertext_0.clone(); LEN];
+    };
+    if i >= args.len {
+        panic!("ERROR: Index cannot be greater than database length");
+    }
+    bench.note("index", i);
 
-    println!("Input the index to retreive: ");
-    let mut input = String::new();
-    std::io::stdin().read_line(&mut input).expect("Invalid input");
+    bench.run("query_gen", || client_populate(&mut client_vec, args.len, i, &secret_key, rng.clone(), parameters.clone()));
 
-    let trimmed = input.trim();
-    let i = trimmed.parse::<usize>().expect("Please input an integer...");
-    client_populate(&mut client_vec, LEN, i, &secret_key, rng, parameters);
+    let retrieved_val = bench.run("compute", || server_compute(&data, &client_vec));
+    let (retrieved_val_plaintext, retrieved_val_decrypted) = bench.run("decrypt", || client_decrypt(&retrieved_val, &secret_key));
 
-    let retrieved_val = server_compute(&data, &client_vec);
-    let (retrieved_val_plaintext, retrieved_val_decrypted) = client_decrypt(&retrieved_val, &secret_key);
+    let query_bytes: usize = client_vec.iter().map(|c| c.to_bytes().len()).sum();
+    bench.note("query_bytes", query_bytes);
+    bench.note("response_bytes", retrieved_val.to_bytes().len());
+    bench.note("correct", (retrieved_val_plaintext == data[i]) as u8);
+    if let Some(path) = &args.json {
+        bench.write_json(path).expect("ERROR: Could not write benchmark report");
+    }
 
     assert_eq!(retrieved_val_plaintext, data[i]);
     println!("Retrieved: 0x{:x}", retrieved_val_decrypted);
@@ -76,4 +107,4 @@ fn client_decrypt(server_val: &Ciphertext, secret_key: &SecretKey) -> (Plaintext
     let decrypted_plaintext = secret_key.try_decrypt(&server_val).unwrap();
     let decrypted_vector = Vec::<u64>::try_decode(&decrypted_plaintext, Encoding::poly()).unwrap();
     (decrypted_plaintext, decrypted_vector[0])
-}
\ No newline at end of file
+}
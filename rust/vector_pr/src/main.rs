@@ -1,11 +1,12 @@
+mod bench;
 mod util;
 
+use bench::{shared_db_values, Args, Bench};
 use fhe::bfv::{BfvParametersBuilder, BfvParameters, Ciphertext, Encoding, Plaintext, PublicKey, SecretKey, self};
 use fhe_traits::*;
 use rand::{rngs::OsRng, thread_rng, rngs::ThreadRng, Rng};
 use core::panic;
 use std::sync::Arc;
-use util::timing::{timeit, timeit_n};
 
 //debug
 // use std::env;
@@ -17,12 +18,16 @@ fn main() {
     const POLY_DEG: usize = 2048;
     let cipher_mod: &[u64] = &[0x3fffffff000001];
     const PLAIN_MOD: u64 = 1 << 10;
+    const LEN: usize = 100;
+
+    // the constants above, unless overridden on the command line (see bench::Args)
+    let args = Args::parse(POLY_DEG, PLAIN_MOD, cipher_mod, LEN);
 
     let parameters = Arc::new(
         BfvParametersBuilder::new()
-            .set_degree(POLY_DEG)
-            .set_moduli(cipher_mod)
-            .set_plaintext_modulus(PLAIN_MOD)
+            .set_degree(args.n)
+            .set_moduli(&args.moduli)
+            .set_plaintext_modulus(args.t)
             .build()
             .unwrap(),
     );
@@ -33,42 +38,76 @@ fn main() {
 
     let plaintext_0 = Plaintext::try_encode(&[0_u64], Encoding::poly(), &parameters).unwrap();
     let ciphertext_0: Ciphertext = secret_key.try_encrypt(&plaintext_0, &mut rng).unwrap();
-    
-    const LEN: usize = 100;
 
-    let mut data = vec![];
-
-    timeit!("Database creation",
-        for _i in 0..LEN {
-            let rand_val: i64 = rng.gen_range(1..PLAIN_MOD).try_into().unwrap();
-            let p = Plaintext::try_encode(&[rand_val], Encoding::poly(), &parameters).unwrap();
-            data.push(p);
-        }
-    );
-
-    let vec_len: usize = (LEN as f64).sqrt() as usize;
-    if LEN != vec_len * vec_len {
+    let vec_len: usize = (args.len as f64).sqrt() as usize;
+    if args.len != vec_len * vec_len {
         panic!("ERROR: Database length must be a square");
     }
 
+    let mut bench = Bench::new("vector_pr_rust", &args);
+    // without --seed the database is random, as before
+    let seed = args.seed.unwrap_or_else(|| rng.gen());
+    let moduli: Vec<String> = args.moduli.iter().map(|q| q.to_string()).collect();
+    bench.note_str("library", "fhe.rs");
+    bench.note_str("variant", "vector");
+    bench.note("n", args.n);
+    bench.note("t", args.t);
+    bench.note_str("moduli", &moduli.join(","));
+    bench.note("len", args.len);
+    bench.note("seed", seed);
+
+    // vec_len rows of vec_len plaintexts, filled row-major like the C++ database
+    let values = shared_db_values(seed, args.len, args.t);
+    let data: Vec<Vec<Plaintext>> = bench.run("db_init", || {
+        values
+            .chunks(vec_len)
+            .map(|row| {
+                row.iter()
+                    .map(|v| Plaintext::try_encode(&[*v], Encoding::poly(), &parameters).unwrap())
+                    .collect()
+            })
+            .collect()
+    });
+
     let mut col_select_vec = vec![ciphertext_0.clone(); vec_len];
     let mut row_select_vec = vec![ciphertext_0.clone(); vec_len];
 
-    println!("Input the index to retreive: ");
-    let mut input = String::new();
-    std::io::stdin().read_line(&mut input).expect("Invalid input");
-
-    let trimmed = input.trim();
-    let i = trimmed.parse::<usize>().expect("Please input an integer...");
-    client_populate(&mut col_select_vec, &mut row_select_vec, LEN, i, &secret_key, rng, parameters);
+    let i = match args.index {
+        Some(i) => i,
+        None => {
+            println!("Input the index to retreive: ");
+            let mut input = String::new();
+            std::io::stdin().read_line(&mut input).expect("Invalid input");
 
-    let start_comp = std::time::Instant::now();
-    let intermediate_vec = vector_dot_cp(&data, &col_select_vec);
-    let retrieved_val = vector_dot_cc(&intermediate_vec, &row_select_vec);
-    println!("⏱  Total computation time: {} s", start_comp.elapsed().as_secs_f64());
-    let (retrieved_val_plaintext, retrieved_val_decrypted) = client_decrypt(&retrieved_val, &secret_key);
+            let trimmed = input.trim();
+            trimmed.parse::<usize>().expect("Please input an integer...")
+        }
+    };
+    if i >= args.len {
+        panic!("ERROR: Index cannot be greater than database length");
+    }
+    bench.note("index", i);
+
+    bench.run("query_gen", || {
+        client_populate(&mut col_select_vec, &mut row_select_vec, args.len, i, &secret_key, rng.clone(), parameters.clone())
+    });
+
+    let retrieved_val = bench.run("compute", || {
+        let intermediate_vec = vector_dot_cp(&data, &col_select_vec);
+        vector_dot_cc(&intermediate_vec, &row_select_vec)
+    });
+    let (retrieved_val_plaintext, retrieved_val_decrypted) = bench.run("decrypt", || client_decrypt(&retrieved_val, &secret_key));
+
+    let expected = &data[i / vec_len][i % vec_len];
+    let query_bytes: usize = col_select_vec.iter().chain(row_select_vec.iter()).map(|c| c.to_bytes().len()).sum();
+    bench.note("query_bytes", query_bytes);
+    bench.note("response_bytes", retrieved_val.to_bytes().len());
+    bench.note("correct", (&retrieved_val_plaintext == expected) as u8);
+    if let Some(path) = &args.json {
+        bench.write_json(path).expect("ERROR: Could not write benchmark report");
+    }
 
-    assert_eq!(retrieved_val_plaintext, data[i]);
+    assert_eq!(&retrieved_val_plaintext, expected);
     println!("Retrieved: 0x{:?}", retrieved_val_decrypted);
 }
 
@@ -84,29 +123,24 @@ fn client_populate(col_select_vec: &mut Vec<Ciphertext>, row_select_vec: &mut Ve
     let row = index / vec_len;
     let col = index % vec_len;
 
-    timeit!("Time to initialize retrieval vectors", 
-        for i in 0..vec_len {
-            col_select_vec[i] = secret_key.try_encrypt(&plaintext_zero, &mut rng).unwrap();
-            row_select_vec[i] = secret_key.try_encrypt(&plaintext_zero, &mut rng).unwrap();
-
-            if i == col {
-                col_select_vec[i] = secret_key.try_encrypt(&plaintext_one, &mut rng).unwrap();
-            }
-            if i == row {
-                row_select_vec[i] = secret_key.try_encrypt(&plaintext_one, &mut rng).unwrap();
-            }
+    for i in 0..vec_len {
+        col_select_vec[i] = secret_key.try_encrypt(&plaintext_zero, &mut rng).unwrap();
+        row_select_vec[i] = secret_key.try_encrypt(&plaintext_zero, &mut rng).unwrap();
+
+        if i == col {
+            col_select_vec[i] = secret_key.try_encrypt(&plaintext_one, &mut rng).unwrap();
         }
-    );
+        if i == row {
+            row_select_vec[i] = secret_key.try_encrypt(&plaintext_one, &mut rng).unwrap();
+        }
+    }
 }
 
-fn vector_dot_cp(data: &Vec<Plaintext>, client_array: &Vec<Ciphertext>) -> Vec<Ciphertext> {
-    let mut ret = vec![];
-    timeit!("Time to computer ciphertext-plaintext dot product",
-        for _ in 0..client_array.len() {
-            ret.push(bfv::dot_product_scalar(client_array.iter(), data.iter()).unwrap());
-        }
-    );
-    ret
+// one ct x pt dot product per database row
+fn vector_dot_cp(data: &Vec<Vec<Plaintext>>, client_array: &Vec<Ciphertext>) -> Vec<Ciphertext> {
+    data.iter()
+        .map(|row| bfv::dot_product_scalar(client_array.iter(), row.iter()).unwrap())
+        .collect()
 }
 
 fn vector_dot_cc(data: &Vec<Ciphertext>, client_array: &Vec<Ciphertext>) -> Ciphertext {
@@ -116,12 +150,10 @@ fn vector_dot_cc(data: &Vec<Ciphertext>, client_array: &Vec<Ciphertext>) -> Ciph
     let mut result = &data[0] * &client_array[0];
     let mut temp;
 
-    timeit!("Time to computer ciphertext-ciphertext dot product",
-        for (i, c) in client_array[1..].iter().enumerate() {
-            temp = c * &data[i];
-            result += &temp;
-        }
-    );
+    for (c, d) in client_array[1..].iter().zip(data[1..].iter()) {
+        temp = c * d;
+        result += &temp;
+    }
     result
 }
 
@@ -129,4 +161,4 @@ fn client_decrypt(server_val: &Ciphertext, secret_key: &SecretKey) -> (Plaintext
     let decrypted_plaintext = secret_key.try_decrypt(&server_val).unwrap();
     let decrypted_vector = Vec::<u64>::try_decode(&decrypted_plaintext, Encoding::poly()).unwrap();
     (decrypted_plaintext, decrypted_vector[0])
-}
\ No newline at end of file
+}
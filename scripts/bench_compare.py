@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+"""Performance regression gate for the PIR binaries.
+
+Runs a fixed set of trivial_pr, vector_pr and bfv_playground scenarios non-interactively (the
+index or polynomial selection is fed on stdin), collects their BenchHarness JSON reports
+(cpp/common/pir_bench.h) and compares every phase with a committed baseline.
+
+A phase regresses when its median wall time is more than --threshold slower than the baseline
+and a one-sided Mann-Whitney U test over the raw samples says the slowdown is significant at
+--alpha. A bootstrap 95% confidence interval of the median ratio is printed next to each phase.
+Phases with fewer than 3 samples on either side (the ones BenchHarness measures once) are shown
+but never gate. The exit status is 1 when anything regressed.
+
+    scripts/bench_compare.py --update-baseline          # run and write bench/baseline.json
+    scripts/bench_compare.py                            # run and compare with it
+    scripts/bench_compare.py --current results.json     # compare an earlier run without rerunning
+"""
+
+import argparse
+import json
+import math
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+MIN_SAMPLES = 3
+
+# name: (binary relative to the build directory, extra arguments, stdin)
+SCENARIOS = {
+    "trivial_pr": ("trivial_pr/trivial_pr", [], "3\n"),
+    "vector_pr": ("vector_pr/vector_pr", [], "3\n"),
+    "vector_pr_fused": ("vector_pr/vector_pr", ["--fused-cc"], "3\n"),
+    "bfv_playground_x2_plus_3x": ("SEAL_demo/bfv_playground", [], "5\n0\n"),
+    "bfv_playground_x4_relin": ("SEAL_demo/bfv_playground", [], "7\n0\n"),
+}
+
+
+def run_scenario(build_dir, name, warmup, trials):
+    """Runs one scenario with --bench-json and returns the report it wrote."""
+    binary, extra, stdin = SCENARIOS[name]
+    with tempfile.NamedTemporaryFile(suffix=".json", delete=False) as f:
+        path = f.name
+    try:
+        cmd = [os.path.join(build_dir, binary)] + extra + ["--warmup", str(warmup), "--trials", str(trials), "--bench-json", path]
+        print("$ " + " ".join(cmd), flush=True)
+        proc = subprocess.run(cmd, input=stdin, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        if proc.returncode != 0:
+            sys.exit("ERROR: scenario " + name + " failed:\n" + proc.stdout)
+        with open(path) as f:
+            return json.load(f)
+    finally:
+        os.unlink(path)
+
+
+def mann_whitney_greater(current, baseline):
+    """One-sided p-value that current is stochastically larger (slower) than baseline.
+
+    Normal approximation of U with tie correction and continuity correction; the sample counts
+    here (trials per phase) are small but above the point where the approximation breaks down.
+    """
+    n1, n2 = len(current), len(baseline)
+    pooled = sorted([(v, 0) for v in current] + [(v, 1) for v in baseline])
+    ranks = [0.0] * len(pooled)
+    ties = 0.0
+    i = 0
+    while i < len(pooled):
+        j = i
+        while j + 1 < len(pooled) and pooled[j + 1][0] == pooled[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2.0 + 1
+        size = j - i + 1
+        ties += size ** 3 - size
+        i = j + 1
+    r1 = sum(r for r, (_, side) in zip(ranks, pooled) if side == 0)
+    u1 = r1 - n1 * (n1 + 1) / 2.0
+    n = n1 + n2
+    variance = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (u1 - n1 * n2 / 2.0 - 0.5) / math.sqrt(variance)
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def median(values):
+    s = sorted(values)
+    mid = len(s) // 2
+    return s[mid] if len(s) % 2 else (s[mid - 1] + s[mid]) / 2.0
+
+
+def bootstrap_ratio_ci(current, baseline, rounds, rng):
+    """95% percentile bootstrap interval of median(current) / median(baseline)."""
+    ratios = []
+    for _ in range(rounds):
+        c = median([rng.choice(current) for _ in current])
+        b = median([rng.choice(baseline) for _ in baseline])
+        if b > 0:
+            ratios.append(c / b)
+    if not ratios:
+        return float("nan"), float("nan")
+    ratios.sort()
+    return ratios[int(0.025 * (len(ratios) - 1))], ratios[int(0.975 * (len(ratios) - 1))]
+
+
+def phase_samples(report):
+    return {p["name"]: p["samples_wall_s"] for p in report["phases"]}
+
+
+def compare(baseline, current, args):
+    """Prints the per-phase diff table and returns the list of regressed scenario/phase pairs."""
+    rng = random.Random(args.seed)
+    regressions = []
+    print()
+    print("%-28s %-26s %12s %12s %8s %17s %9s  %s" % (
+        "scenario", "phase", "base (ms)", "now (ms)", "change", "95% CI (ratio)", "p", "verdict"))
+    for name in sorted(current):
+        if name not in baseline:
+            print("%-28s %-26s %s" % (name, "-", "no baseline, skipped"))
+            continue
+        base_phases = phase_samples(baseline[name])
+        for phase, samples in phase_samples(current[name]).items():
+            if phase not in base_phases:
+                print("%-28s %-26s %s" % (name, phase, "no baseline, skipped"))
+                continue
+            base = base_phases[phase]
+            b, c = median(base), median(samples)
+            change = c / b - 1 if b > 0 else float("nan")
+            if len(samples) < MIN_SAMPLES or len(base) < MIN_SAMPLES:
+                print("%-28s %-26s %12.3f %12.3f %+7.1f%% %17s %9s  %s" % (
+                    name, phase, b * 1e3, c * 1e3, change * 100, "-", "-", "single sample"))
+                continue
+            lo, hi = bootstrap_ratio_ci(samples, base, args.bootstrap, rng)
+            p = mann_whitney_greater(samples, base)
+            if change > args.threshold and p < args.alpha:
+                verdict = "REGRESSION"
+                regressions.append((name, phase))
+            elif change < -args.threshold and mann_whitney_greater(base, samples) < args.alpha:
+                verdict = "faster"
+            else:
+                verdict = "ok"
+            print("%-28s %-26s %12.3f %12.3f %+7.1f%% %8.3f-%-8.3f %9.4f  %s" % (
+                name, phase, b * 1e3, c * 1e3, change * 100, lo, hi, p, verdict))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--build-dir", default=os.path.join(REPO, "cpp"),
+                        help="directory holding trivial_pr/, vector_pr/ and SEAL_demo/ builds")
+    parser.add_argument("--baseline", default=os.path.join(REPO, "bench", "baseline.json"))
+    parser.add_argument("--scenarios", default=",".join(SCENARIOS), help="comma-separated subset of " + ", ".join(SCENARIOS))
+    parser.add_argument("--warmup", type=int, default=2)
+    parser.add_argument("--trials", type=int, default=15)
+    parser.add_argument("--threshold", type=float, default=0.10, help="relative median slowdown that fails (0.10 = 10%%)")
+    parser.add_argument("--alpha", type=float, default=0.01, help="significance level of the Mann-Whitney test")
+    parser.add_argument("--bootstrap", type=int, default=2000, help="bootstrap resamples for the confidence interval")
+    parser.add_argument("--seed", type=int, default=1, help="bootstrap RNG seed")
+    parser.add_argument("--current", help="compare this results file instead of running the scenarios")
+    parser.add_argument("--out", help="also write this run's results here")
+    parser.add_argument("--update-baseline", action="store_true", help="write this run to --baseline instead of comparing")
+    args = parser.parse_args()
+
+    if args.current:
+        with open(args.current) as f:
+            current = json.load(f)["scenarios"]
+    else:
+        names = [s for s in args.scenarios.split(",") if s]
+        for name in names:
+            if name not in SCENARIOS:
+                sys.exit("ERROR: unknown scenario " + name)
+        current = {name: run_scenario(args.build_dir, name, args.warmup, args.trials) for name in names}
+
+    results = {"warmup": args.warmup, "trials": args.trials, "scenarios": current}
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(results, f, indent=2)
+    if args.update_baseline:
+        os.makedirs(os.path.dirname(os.path.abspath(args.baseline)), exist_ok=True)
+        with open(args.baseline, "w") as f:
+            json.dump(results, f, indent=2)
+        print("Wrote baseline " + args.baseline)
+        return 0
+
+    if not os.path.exists(args.baseline):
+        sys.exit("ERROR: no baseline at " + args.baseline + ", create one with --update-baseline on a quiet machine")
+    with open(args.baseline) as f:
+        baseline = json.load(f)["scenarios"]
+
+    regressions = compare(baseline, current, args)
+    print()
+    if regressions:
+        print("FAIL: %d phase(s) more than %.0f%% slower than the baseline: %s" % (
+            len(regressions), args.threshold * 100, ", ".join(n + "/" + p for n, p in regressions)))
+        return 1
+    print("PASS: no phase more than %.0f%% slower than the baseline" % (args.threshold * 100))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""SEAL (C++) vs fhe.rs (Rust) PIR comparison.
+
+Runs cpp/vector_pr's pir_crosslib and the matching Rust binary (rust/trivial_pr or
+rust/vector_pr) with the same BFV parameters, database seed and index. Both write the
+BenchHarness JSON schema (cpp/common/pir_bench.h). This script collects the reports into one
+file and prints side-by-side per-phase latency and throughput.
+
+SEAL runs first. When --moduli-bits is given, SEAL picks the primes, and the exact values it
+reports are passed to fhe.rs, so both libraries use the same coefficient modulus.
+
+    scripts/crosslib_compare.py --n 4096 --t 65537 --moduli-bits 36,36,37 --len 1600 --trials 10
+"""
+
+import argparse
+import csv
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+PHASES = ["db_init", "query_gen", "compute", "decrypt"]
+
+
+def run_report(cmd):
+    """Runs one benchmark binary with --bench-json and returns the report it wrote."""
+    with tempfile.NamedTemporaryFile(suffix=".json", delete=False) as f:
+        path = f.name
+    try:
+        print("$ " + " ".join(cmd + ["--bench-json", path]), flush=True)
+        proc = subprocess.run(cmd + ["--bench-json", path], stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        if proc.returncode != 0:
+            sys.exit("ERROR: command failed:\n" + proc.stdout)
+        with open(path) as f:
+            return json.load(f)
+    finally:
+        os.unlink(path)
+
+
+def common_args(args):
+    return ["--n", str(args.n), "--t", str(args.t), "--len", str(args.len), "--seed", str(args.seed),
+            "--index", str(args.index), "--warmup", str(args.warmup), "--trials", str(args.trials)]
+
+
+def phase_stats(report, phase):
+    for p in report["phases"]:
+        if p["name"] == phase:
+            return p["wall_s"]
+    return None
+
+
+def print_table(variant, seal, rust):
+    print()
+    print("%s PIR, n=%s, t=%s, q=[%s], len=%s, %s trials" % (
+        variant, seal["params"]["n"], seal["params"]["t"], seal["params"]["moduli"], seal["params"]["len"], seal["trials"]))
+    print("%-10s %16s %16s %16s %16s %12s" % ("phase", "SEAL med (ms)", "fhe.rs med (ms)", "SEAL p95 (ms)", "fhe.rs p95 (ms)", "fhe.rs/SEAL"))
+    for phase in PHASES:
+        s = phase_stats(seal, phase)
+        r = phase_stats(rust, phase)
+        if s is None or r is None:
+            continue
+        ratio = r["median"] / s["median"] if s["median"] > 0 else float("nan")
+        print("%-10s %16.3f %16.3f %16.3f %16.3f %12.2f" % (phase, s["median"] * 1e3, r["median"] * 1e3, s["p95"] * 1e3, r["p95"] * 1e3, ratio))
+
+    # throughput is derived from the median compute time: records scanned per second and queries per second
+    length = float(seal["params"]["len"])
+    print("%-22s %16s %16s" % ("", "SEAL", "fhe.rs"))
+    s_compute = phase_stats(seal, "compute")["median"]
+    r_compute = phase_stats(rust, "compute")["median"]
+    print("%-22s %16.0f %16.0f" % ("records/s (compute)", length / s_compute, length / r_compute))
+    print("%-22s %16.2f %16.2f" % ("queries/s (compute)", 1.0 / s_compute, 1.0 / r_compute))
+    for key in ["query_bytes", "response_bytes", "noise_budget", "correct"]:
+        print("%-22s %16s %16s" % (key, seal["params"].get(key, "-"), rust["params"].get(key, "-")))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--variant", choices=["trivial", "vector", "both"], default="both")
+    parser.add_argument("--n", type=int, default=2048)
+    parser.add_argument("--t", type=int, default=1 << 10)
+    moduli = parser.add_mutually_exclusive_group()
+    moduli.add_argument("--moduli", default="0x3fffffff000001", help="comma-separated coefficient moduli")
+    moduli.add_argument("--moduli-bits", help="comma-separated prime sizes, primes chosen by SEAL")
+    parser.add_argument("--len", type=int, default=100, help="database length (a square for vector)")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--index", type=int, default=0)
+    parser.add_argument("--warmup", type=int, default=1)
+    parser.add_argument("--trials", type=int, default=10)
+    parser.add_argument("--seal-bin", default=os.path.join(REPO, "cpp", "vector_pr", "pir_crosslib"))
+    parser.add_argument("--rust-dir", default=os.path.join(REPO, "rust"))
+    parser.add_argument("--out", default="crosslib.json", help="combined reports")
+    parser.add_argument("--csv", help="also write one row per library, variant and phase")
+    args = parser.parse_args()
+
+    variants = ["trivial", "vector"] if args.variant == "both" else [args.variant]
+    runs = []
+    for variant in variants:
+        seal_cmd = [args.seal_bin, "--variant", variant] + common_args(args)
+        seal_cmd += ["--moduli-bits", args.moduli_bits] if args.moduli_bits else ["--moduli", args.moduli]
+        seal = run_report(seal_cmd)
+
+        manifest = os.path.join(args.rust_dir, variant + "_pr", "Cargo.toml")
+        rust_cmd = ["cargo", "run", "--release", "--quiet", "--manifest-path", manifest, "--"] + common_args(args)
+        rust_cmd += ["--moduli", seal["params"]["moduli"]]
+        rust = run_report(rust_cmd)
+
+        print_table(variant, seal, rust)
+        runs += [seal, rust]
+
+    with open(args.out, "w") as f:
+        json.dump({"runs": runs}, f, indent=2)
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(["library", "variant", "n", "t", "moduli", "len", "phase", "trials", "min_s", "median_s", "p95_s", "p99_s", "mean_s"])
+            for run in runs:
+                p = run["params"]
+                for phase in run["phases"]:
+                    w = phase["wall_s"]
+                    writer.writerow([p["library"], p["variant"], p["n"], p["t"], p["moduli"], p["len"], phase["name"],
+                                     phase["trials"], w["min"], w["median"], w["p95"], w["p99"], w["mean"]])
+    print()
+    print("Wrote " + args.out + (" and " + args.csv if args.csv else ""))
+
+
+if __name__ == "__main__":
+    main()